@@ -0,0 +1,444 @@
+#include "batch.h"
+#include "../filter/filter.h"
+#include "../pixelwise/pixelwise.h"
+#include "../server/server.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <new>
+#include <opencv2/opencv.hpp>
+#include <sched.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace batch {
+
+namespace {
+constexpr size_t WORKER_CACHE_BYTES = 64 << 20;  // ワーカごとの処理結果のキャッシュの上限 (同じ画像と処理は省略)
+
+enum JobState : int32_t
+{
+    Pending = 0,
+    Done    = 1,
+    Failed  = 2,
+};
+
+// ワーカごとの共有メモリ上の状態 (偽共有を避けるためキャッシュラインごとに置く)
+struct alignas(64) SharedWorker
+{
+    std::atomic<uint64_t> range{0};  // 残りのジョブ (上位32ビットが先頭、下位32ビットが末尾のorderの添字)
+    std::atomic<uint64_t> jobsDone{0};
+    std::atomic<uint64_t> jobsFailed{0};
+    std::atomic<uint64_t> stolen{0};
+    std::atomic<uint64_t> pixelBytes{0};
+    std::atomic<uint64_t> busyNs{0};
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "プロセス間で共有するためロックフリーである必要がある");
+
+inline uint64_t packRange(uint32_t head, uint32_t tail)
+{
+    return (static_cast<uint64_t>(head) << 32) | tail;
+}
+
+// 自分の残りの先頭から取る
+bool popFront(std::atomic<uint64_t> &range, uint32_t &pos)
+{
+    uint64_t v = range.load();
+    while (static_cast<uint32_t>(v >> 32) < static_cast<uint32_t>(v)) {
+        if (range.compare_exchange_weak(v, packRange(static_cast<uint32_t>(v >> 32) + 1, static_cast<uint32_t>(v)))) {
+            pos = static_cast<uint32_t>(v >> 32);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 他のワーカの残りの末尾から奪う (持ち主と反対側から取るため競合しにくい)
+bool popBack(std::atomic<uint64_t> &range, uint32_t &pos)
+{
+    uint64_t v = range.load();
+    while (static_cast<uint32_t>(v >> 32) < static_cast<uint32_t>(v)) {
+        if (range.compare_exchange_weak(v, packRange(static_cast<uint32_t>(v >> 32), static_cast<uint32_t>(v) - 1))) {
+            pos = static_cast<uint32_t>(v) - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hasWork(const std::atomic<uint64_t> &range)
+{
+    uint64_t v = range.load();
+    return static_cast<uint32_t>(v >> 32) < static_cast<uint32_t>(v);
+}
+
+// "0-3,8-11"の形式のCPUの一覧を読む
+std::vector<int32_t> parseCpuList(const std::string &text)
+{
+    std::vector<int32_t> cpus;
+    std::stringstream    ss(text);
+    std::string          item;
+    while (std::getline(ss, item, ',')) {
+        int32_t first, last;
+        if (std::sscanf(item.c_str(), "%d-%d", &first, &last) == 2) {
+            for (int32_t cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        } else if (std::sscanf(item.c_str(), "%d", &first) == 1) {
+            cpus.push_back(first);
+        }
+    }
+    return cpus;
+}
+
+// 1枚の画像を読み込んで処理し、書き出す
+bool runJob(const Job &job, pixelwise::ImageProcessor &ips, filter::ImageProcessor &ips2,
+            cache::ResultCache &resultCache, uint64_t &pixelBytes)
+{
+    try {
+        Mat img = imread(job.inPath);
+        if (img.empty() || img.type() != CV_8UC3) {
+            return false;
+        }
+
+        server::Request request = job.request;
+        request.height          = img.rows;
+        request.width           = img.cols;
+        Mat outImg              = Mat{img.rows, img.cols, CV_8UC3, Scalar(0, 0, 0)};
+        if (server::processFrame(request, img, outImg, ips, ips2, &resultCache) != server::Status::Ok) {
+            return false;
+        }
+
+        pixelBytes = img.total() * img.elemSize();
+        return imwrite(job.outPath, outImg);
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+// ワーカプロセスの本体 (自分の残りがなくなれば他のワーカから奪い、すべてなくなれば終了する)
+[[noreturn]] void workerMain(int32_t slot, const std::vector<Job> &jobs, const std::vector<int32_t> &order,
+                             const std::vector<int32_t> &victims, const std::vector<int32_t> &cpus,
+                             const tune::Profile &profile, int32_t maxThreads, SharedWorker *workers,
+                             std::atomic<int32_t> *states)
+{
+    if (!cpus.empty()) {
+        // ノードのCPUに固定する (以降に確保するメモリはファーストタッチでノードのメモリに置かれる)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int32_t cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+
+    pixelwise::ImageProcessor ips;
+    filter::ImageProcessor    ips2;
+    cache::ResultCache        resultCache(WORKER_CACHE_BYTES);
+    SharedWorker             &self = workers[slot];
+    profile.apply(ips2, maxThreads);
+
+    while (true) {
+        uint32_t pos;
+        bool     stolen = false;
+        if (!popFront(self.range, pos)) {
+            auto it = std::find_if(victims.begin(), victims.end(),
+                                   [&](int32_t victim) { return popBack(workers[victim].range, pos); });
+            if (it == victims.end()) {
+                break;
+            }
+            stolen = true;
+        }
+
+        int32_t index = order[pos];
+
+        auto     started    = std::chrono::steady_clock::now();
+        uint64_t pixelBytes = 0;
+        bool     ok         = runJob(jobs[index], ips, ips2, resultCache, pixelBytes);
+        auto     finished   = std::chrono::steady_clock::now();
+
+        // 途中で異常終了した場合はPendingのまま残り、コーディネータが実行し直す
+        states[index].store(ok ? JobState::Done : JobState::Failed);
+        (ok ? self.jobsDone : self.jobsFailed)++;
+        self.stolen += stolen ? 1 : 0;
+        self.pixelBytes += pixelBytes;
+        self.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(finished - started).count();
+    }
+    _exit(0);
+}
+}  // namespace
+
+/*************************************************
+ * bool readJobList(const std::string &path, std::vector<Job> &jobs)
+ * const std::string &path : ジョブの一覧のファイル
+ * std::vector<Job> &jobs : 読み込んだジョブ (末尾に追加)
+ *
+ * 機能 : 1行に1ジョブの一覧を読み込む ('#'以降と空行は無視)
+ *        入力画像 出力画像 pixelwise|filter ipsTypeの値 [param0 param1 param2 param3 [borderTypeの値]]
+ *        paramsの意味はserver::processFrameと同じ
+ *
+ * return : bool 開けない、または書式が不正な行がある場合はfalse
+ *************************************************/
+bool readJobList(const std::string &path, std::vector<Job> &jobs)
+{
+    std::ifstream ifs(path);
+    if (!ifs) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream iss(line);
+        Job                job;
+        std::string        module;
+        if (!(iss >> job.inPath)) {
+            continue;  // 空行
+        }
+        if (!(iss >> job.outPath >> module >> job.request.ipsType) || (module != "pixelwise" && module != "filter")) {
+            return false;
+        }
+        job.request.module = module == "pixelwise" ? server::Module::Pixelwise : server::Module::Filter;
+        for (int32_t i = 0; i < server::PARAM_NUM; i++) {
+            if (!(iss >> job.request.params[i])) {
+                job.request.params[i] = 0.0;
+                break;
+            }
+        }
+        iss.clear();
+        iss >> job.request.borderType;
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+/*************************************************
+ * std::vector<std::vector<int32_t>> numaNodeCpus()
+ *
+ * 機能 : NUMAノードごとに、このプロセスが使えるCPUの番号を求める
+ *        (sysfsから読めない場合は使えるCPUすべてを1つのノードとする)
+ *
+ * return : std::vector<std::vector<int32_t>> ノードごとのCPU番号
+ *************************************************/
+std::vector<std::vector<int32_t>> numaNodeCpus()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return {};
+    }
+
+    std::vector<std::vector<int32_t>> nodes;
+    for (int32_t node = 0;; node++) {
+        std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string   text;
+        if (!std::getline(ifs, text)) {
+            break;
+        }
+
+        // コンテナなどで使えないCPUは除く
+        std::vector<int32_t> cpus = parseCpuList(text);
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                  [&](int32_t cpu) { return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed); }),
+                   cpus.end());
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+
+    if (nodes.empty()) {
+        std::vector<int32_t> cpus;
+        for (int32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+/*************************************************
+ * Coordinator(int32_t workerNum)
+ * int32_t workerNum : ワーカプロセスの数 (0の場合はCPUのスレッド数)
+ *************************************************/
+Coordinator::Coordinator(int32_t workerNum) : workerNum_(workerNum), nodeCpus_(numaNodeCpus())
+{
+    if (workerNum_ <= 0) {
+        workerNum_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+/*************************************************
+ * void setProfile(tune::Profile profile)
+ * tune::Profile profile : 自動調整の設定 (tune::loadOrTuneで読み込むか計測する)
+ *
+ * 機能 : 各ワーカのフィルタ処理に指定する設定を保持 (ワーカごとに計測し直さない)
+ *
+ * return : void
+ *************************************************/
+void Coordinator::setProfile(tune::Profile profile)
+{
+    profile_ = std::move(profile);
+}
+
+/*************************************************
+ * BatchResult run(const std::vector<Job> &jobs)
+ * const std::vector<Job> &jobs : ジョブの一覧
+ *
+ * 機能 : ジョブをワーカの数に分けて割り当て、ワーカプロセスを起動してすべて終わるまで待つ
+ *        ワーカが異常終了した場合、残りがあれば同じ割り当てで起動し直す
+ *        処理中だったジョブは全員の終了後に次の回でまとめて実行し直す
+ *        (スレッドを起動する前に呼ぶこと、forkで子プロセスを作るため)
+ *
+ * return : BatchResult ワーカごとと全体の集計
+ *************************************************/
+BatchResult Coordinator::run(const std::vector<Job> &jobs)
+{
+    BatchResult result;
+    int32_t     jobNum = static_cast<int32_t>(jobs.size());
+    auto        start  = std::chrono::steady_clock::now();
+
+    // ワーカの状態とジョブの状態をプロセス間の共有メモリに置く (forkした子プロセスと共有する)
+    size_t workerBytes = sizeof(SharedWorker) * workerNum_;
+    size_t sharedBytes = workerBytes + sizeof(std::atomic<int32_t>) * std::max(jobNum, 1);
+    void  *shared      = mmap(nullptr, sharedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        for (int32_t i = 0; i < jobNum; i++) {
+            result.failedJobs.push_back(i);
+        }
+        return result;
+    }
+    SharedWorker         *workers = static_cast<SharedWorker *>(shared);
+    std::atomic<int32_t> *states =
+        reinterpret_cast<std::atomic<int32_t> *>(static_cast<uint8_t *>(shared) + workerBytes);
+    for (int32_t w = 0; w < workerNum_; w++) {
+        new (&workers[w]) SharedWorker();
+    }
+    for (int32_t i = 0; i < jobNum; i++) {
+        new (&states[i]) std::atomic<int32_t>(JobState::Pending);
+    }
+
+    // ワーカをノードに順に割り当て、奪う相手は同じノードのワーカを先にする
+    result.workers.resize(workerNum_);
+    std::vector<std::vector<int32_t>> victims(workerNum_);
+    for (int32_t w = 0; w < workerNum_; w++) {
+        result.workers[w].node = nodeCpus_.empty() ? 0 : w % static_cast<int32_t>(nodeCpus_.size());
+    }
+    for (int32_t w = 0; w < workerNum_; w++) {
+        for (int32_t i = 1; i < workerNum_; i++) {
+            victims[w].push_back((w + i) % workerNum_);
+        }
+        std::stable_partition(victims[w].begin(), victims[w].end(),
+                              [&](int32_t v) { return result.workers[v].node == result.workers[w].node; });
+    }
+
+    std::vector<int32_t> attempts(jobNum, 0);
+    std::vector<int32_t> order(jobNum);
+    for (int32_t i = 0; i < jobNum; i++) {
+        order[i] = i;
+    }
+
+    while (!order.empty()) {
+        // 残りのジョブを連続した範囲に分けて割り当てる
+        int64_t pendingNum = static_cast<int64_t>(order.size());
+        for (int32_t w = 0; w < workerNum_; w++) {
+            workers[w].range.store(packRange(static_cast<uint32_t>(pendingNum * w / workerNum_),
+                                             static_cast<uint32_t>(pendingNum * (w + 1) / workerNum_)));
+        }
+
+        std::vector<pid_t>   pids(workerNum_, -1);
+        std::vector<int32_t> noCpus;
+        auto                 spawn = [&](int32_t w) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                workerMain(w, jobs, order, victims[w], nodeCpus_.empty() ? noCpus : nodeCpus_[result.workers[w].node],
+                           profile_, server::threadsPerWorker(workerNum_), workers, states);
+            }
+            pids[w] = pid;
+            if (pid > 0) {
+                result.workers[w].pid = pid;
+            }
+            return pid > 0;
+        };
+
+        int32_t alive = 0;
+        for (int32_t w = 0; w < workerNum_; w++) {
+            alive += spawn(w) ? 1 : 0;
+        }
+
+        while (alive > 0) {
+            int   status;
+            pid_t pid = waitpid(-1, &status, 0);
+            if (pid < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            auto it = std::find(pids.begin(), pids.end(), pid);
+            if (it == pids.end()) {
+                continue;  // このバッチで起動したプロセスではない
+            }
+            int32_t w = static_cast<int32_t>(it - pids.begin());
+            *it       = -1;
+            alive--;
+
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                continue;
+            }
+
+            // 異常終了 : 処理中だったジョブはPendingのまま残り、この回の後に実行し直す
+            result.workers[w].restarts++;
+            bool remaining =
+                std::any_of(workers, workers + workerNum_, [](const SharedWorker &s) { return hasWork(s.range); });
+            if (remaining && spawn(w)) {
+                alive++;
+            }
+        }
+
+        // 終わっていないジョブは異常終了したワーカが処理中だったもの
+        std::vector<int32_t> retry;
+        for (int32_t i : order) {
+            if (states[i].load() != JobState::Pending) {
+                continue;
+            }
+            if (++attempts[i] >= MAX_ATTEMPTS) {
+                states[i].store(JobState::Failed);
+            } else {
+                retry.push_back(i);
+            }
+        }
+        order.swap(retry);
+    }
+
+    for (int32_t w = 0; w < workerNum_; w++) {
+        WorkerStats &stats = result.workers[w];
+        stats.jobsDone     = workers[w].jobsDone.load();
+        stats.jobsFailed   = workers[w].jobsFailed.load();
+        stats.stolen       = workers[w].stolen.load();
+        stats.pixelBytes   = workers[w].pixelBytes.load();
+        stats.busyMs       = workers[w].busyNs.load() / 1e6;
+        result.jobsDone += stats.jobsDone;
+    }
+    for (int32_t i = 0; i < jobNum; i++) {
+        if (states[i].load() != JobState::Done) {
+            result.failedJobs.push_back(i);
+        }
+    }
+    result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    munmap(shared, sharedBytes);
+    return result;
+}
+
+}  // namespace batch
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../server/protocol.h"
+#include "../tune/tune.h"
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// 大量の画像を複数のワーカプロセスで処理するバッチ処理
+// ジョブの割り当てはプロセス間の共有メモリに置き、手の空いたワーカが他のワーカの残りを奪う (work stealing)
+namespace batch {
+
+// 1枚の画像の処理 (処理の指定はデーモンの要求と同じ、server::processFrameで実行する)
+struct Job
+{
+    std::string     inPath;
+    std::string     outPath;
+    server::Request request;  // module, ipsType, params, borderType, borderValueを使う (画像の大きさは読み込み時に設定)
+};
+
+// ワーカごとの集計
+struct WorkerStats
+{
+    pid_t    pid        = 0;    // 最後に起動したプロセス
+    int32_t  node       = 0;    // 割り当てたNUMAノード
+    int32_t  restarts   = 0;    // 異常終了して起動し直した回数
+    uint64_t jobsDone   = 0;
+    uint64_t jobsFailed = 0;    // 読み込み、処理、書き込みに失敗したジョブ
+    uint64_t stolen     = 0;    // 他のワーカから奪ったジョブ
+    uint64_t pixelBytes = 0;    // 処理した画像のバイト数
+    double   busyMs     = 0.0;  // ジョブの処理に使った時間
+
+    double imagesPerSec() const { return busyMs > 0.0 ? jobsDone * 1000.0 / busyMs : 0.0; }
+};
+
+// バッチ全体の集計
+struct BatchResult
+{
+    std::vector<WorkerStats> workers;
+    std::vector<int32_t>     failedJobs;  // 失敗したジョブの添字 (異常終了を繰り返したジョブを含む)
+    uint64_t                 jobsDone  = 0;
+    double                   elapsedMs = 0.0;
+
+    double imagesPerSec() const { return elapsedMs > 0.0 ? jobsDone * 1000.0 / elapsedMs : 0.0; }
+};
+
+bool                              readJobList(const std::string &path, std::vector<Job> &jobs);
+std::vector<std::vector<int32_t>> numaNodeCpus();
+
+// ジョブを複数のワーカプロセスに分けて実行する
+// ワーカはNUMAノードに順に割り当ててそのノードのCPUに固定し、同じノードのワーカから優先して奪う
+// ワーカが異常終了した場合は起動し直し、処理中だったジョブはMAX_ATTEMPTS回まで実行し直す
+class Coordinator
+{
+public:
+    static constexpr int32_t MAX_ATTEMPTS = 2;
+
+    explicit Coordinator(int32_t workerNum = 0);
+
+    void        setProfile(tune::Profile profile);
+    BatchResult run(const std::vector<Job> &jobs);
+
+private:
+    int32_t                           workerNum_;
+    std::vector<std::vector<int32_t>> nodeCpus_;  // NUMAノードごとのCPU番号
+    tune::Profile                     profile_;   // 各ワーカのフィルタ処理に指定する設定
+};
+
+}  // namespace batch
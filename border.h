@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+using namespace cv;
+
+// 画像の端の処理
+enum class BorderType
+{
+    Replicate  = 0,  // aaa|abcd|ddd
+    Reflect101 = 1,  // dcb|abcd|cba
+    Constant   = 2,  // iii|abcd|iii
+    Wrap       = 3   // bcd|abcd|abc
+};
+
+/*************************************************
+ * int32_t borderIndex(int32_t p, int32_t len, BorderType borderType)
+ * int32_t p : 座標 (範囲外でもよい)
+ * int32_t len : 画像の高さまたは横幅
+ * BorderType borderType : 端の処理
+ *
+ * 機能 : 範囲外の座標を端の処理に従って範囲内の座標に変換する
+ *
+ * return : int32_t 範囲内の座標 (Constantで範囲外の場合は-1)
+ *************************************************/
+inline int32_t borderIndex(int32_t p, int32_t len, BorderType borderType)
+{
+    if (p >= 0 && p < len) {
+        return p;
+    }
+
+    switch (borderType) {
+    case BorderType::Replicate:
+        return p < 0 ? 0 : len - 1;
+    case BorderType::Reflect101: {
+        if (len == 1) {
+            return 0;
+        }
+        int32_t period = 2 * (len - 1);
+        p              = (p % period + period) % period;
+        return p < len ? p : period - p;
+    }
+    case BorderType::Wrap:
+        return (p % len + len) % len;
+    default:
+        return -1;
+    }
+}
+
+// 端の処理をした行の参照
+// インプレース処理(入力画像と出力画像が同じ)では、上書きする前の行を保存しておき、保存した行を参照する
+class BorderRows
+{
+public:
+    /*************************************************
+     * BorderRows(Mat img, int32_t height, int32_t width, BorderType borderType, Vec3b borderValue, bool inPlace,
+     *            int32_t keepRows)
+     * Mat img : 入力画像
+     * int32_t height : 高さ
+     * int32_t width : 横幅
+     * BorderType borderType : 画像の端の処理
+     * Vec3b borderValue : BorderType::Constantの画素値
+     * bool inPlace : 入力画像の行を上書きしながら処理する場合はtrue
+     * int32_t keepRows : 上書き後も参照する行数 (カーネルの高さ程度)
+     *************************************************/
+    BorderRows(Mat img, int32_t height, int32_t width, BorderType borderType, Vec3b borderValue, bool inPlace = false,
+               int32_t keepRows = 0)
+        : img_(img), height_(height), rowBytes_(width * 3), borderType_(borderType), inPlace_(inPlace),
+          keepRows_(std::max(keepRows, 1)), constRow_(width * 3)
+    {
+        for (int32_t i = 0; i < rowBytes_; i++) {
+            constRow_[i] = borderValue[i % 3];
+        }
+
+        if (inPlace_ && keepRows_ >= height_) {
+            // 画像が小さい場合は全体を保存
+            img_     = img.clone();
+            inPlace_ = false;
+        } else if (inPlace_) {
+            ring_.resize(static_cast<size_t>(keepRows_) * rowBytes_);
+            // Wrapは下端で上端の行を参照するため、先頭の行も保存
+            if (borderType_ == BorderType::Wrap) {
+                headRows_ = keepRows_;
+                head_.resize(static_cast<size_t>(headRows_) * rowBytes_);
+                for (int32_t y = 0; y < headRows_; y++) {
+                    std::copy(img_.ptr<uint8_t>(y), img_.ptr<uint8_t>(y) + rowBytes_, &head_[y * rowBytes_]);
+                }
+            }
+        }
+    }
+
+    // 行の先頭 (yは範囲外でもよい、Constantの範囲外は定数の行)
+    const uint8_t *row(int32_t y) const
+    {
+        int32_t srcY = borderIndex(y, height_, borderType_);
+        if (srcY < 0) {
+            return constRow_.data();
+        }
+        if (inPlace_ && srcY < retired_) {
+            return srcY < headRows_ ? &head_[static_cast<size_t>(srcY) * rowBytes_]
+                                    : &ring_[static_cast<size_t>(srcY % keepRows_) * rowBytes_];
+        }
+        return img_.ptr<uint8_t>(srcY);
+    }
+
+    // 行yを上書きする前に呼ぶ (yの昇順)
+    void retire(int32_t y)
+    {
+        if (!inPlace_) {
+            return;
+        }
+        std::copy(img_.ptr<uint8_t>(y), img_.ptr<uint8_t>(y) + rowBytes_,
+                  &ring_[static_cast<size_t>(y % keepRows_) * rowBytes_]);
+        retired_ = y + 1;
+    }
+
+private:
+    Mat                  img_;
+    int32_t              height_;
+    int32_t              rowBytes_;
+    BorderType           borderType_;
+    bool                 inPlace_;
+    int32_t              keepRows_;
+    int32_t              retired_  = 0;  // 上書き済みの行数
+    int32_t              headRows_ = 0;
+    std::vector<uint8_t> constRow_;
+    std::vector<uint8_t> ring_;  // 上書き済みの直近keepRows行
+    std::vector<uint8_t> head_;  // 上書き済みの先頭の行 (Wrapのみ)
+};
+
+/*************************************************
+ * void forEachStrip(int32_t height, int32_t tileRows, int32_t threadNum, Fn fn)
+ * int32_t height : 高さ
+ * int32_t tileRows : 帯の行数 (0の場合は高さ / threadNum)
+ * int32_t threadNum : スレッド数
+ * Fn fn : 帯の処理 (int32_t y0, int32_t y1)、[y0, y1)の行を処理する
+ *
+ * 機能 : 行を帯に分け、threadNum個のスレッドが空いた順に次の帯を処理する
+ *        スレッドは呼び出しごとに作らず、OpenCVのスレッドプール(parallel_for_)を使う
+ *        帯は他の帯の入力の行も参照するため、インプレース処理では使えない (threadNumを1にする)
+ *
+ * return : void
+ *************************************************/
+template <typename Fn>
+void forEachStrip(int32_t height, int32_t tileRows, int32_t threadNum, Fn fn)
+{
+    if (threadNum <= 1 || height <= 1) {
+        fn(0, height);
+        return;
+    }
+
+    int32_t rows   = tileRows > 0 ? tileRows : (height + threadNum - 1) / threadNum;
+    int32_t strips = (height + rows - 1) / rows;
+    threadNum      = std::min(threadNum, strips);
+
+    // OpenCVのスレッドプールでthreadNum個の処理を動かし、それぞれが次の帯を取って処理する
+    std::atomic<int32_t> next{0};
+    parallel_for_(
+        Range(0, threadNum),
+        [&](const Range &) {
+            for (int32_t s = next++; s < strips; s = next++) {
+                fn(s * rows, std::min(height, (s + 1) * rows));
+            }
+        },
+        threadNum);
+}
@@ -0,0 +1,372 @@
+#include "cache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+namespace cache {
+
+namespace {
+constexpr uint64_t HASH_MUL1   = 0x9E3779B97F4A7C15ull;
+constexpr uint64_t HASH_MUL2   = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t HASH_MUL3   = 0x94D049BB133111EBull;
+constexpr uint32_t SPILL_MAGIC = 0x32505343;  // "CSP2"
+
+// 書き出したファイルの先頭 (マジックナンバー、高さ、横幅、型、画素値のハッシュ値、キーのバイト列の長さ)
+constexpr uint64_t SPILL_HEADER_BYTES = sizeof(int32_t) * 4 + sizeof(uint64_t) * 2;
+
+// 8バイトの値をハッシュ値に混ぜる
+inline uint64_t mix(uint64_t hash, uint64_t v, uint64_t mul1 = HASH_MUL1, uint64_t mul2 = HASH_MUL2)
+{
+    hash ^= v * mul1;
+    hash = (hash << 31) | (hash >> 33);
+    return hash * mul2;
+}
+
+// バイト列を8バイトずつハッシュ値に混ぜる
+template <typename Mix>
+void mixBytes(const void *data, size_t len, Mix mixValue)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    size_t         i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, p + i, 8);
+        mixValue(v);
+    }
+
+    // 8バイトに満たない残り
+    if (i < len) {
+        uint64_t v = 0;
+        std::memcpy(&v, p + i, len - i);
+        mixValue(v);
+    }
+}
+
+size_t imageBytes(const Mat &img)
+{
+    return img.total() * img.elemSize();
+}
+}  // namespace
+
+/*************************************************
+ * KeyHasher &add(const void *data, size_t len)
+ * const void *data : データ
+ * size_t len : バイト数
+ *
+ * 機能 : データを8バイトずつハッシュ値に混ぜ、キーの比較のためにバイト列を保持する
+ *
+ * return : KeyHasher & 自身
+ *************************************************/
+KeyHasher &KeyHasher::add(const void *data, size_t len)
+{
+    mixBytes(data, len, [this](uint64_t v) { hash_ = mix(hash_, v); });
+    fields_.append(static_cast<const char *>(data), len);
+    len_ += len;
+    return *this;
+}
+
+// 画素値をハッシュ値と画素値のハッシュ値に混ぜる (画素値は大きいためバイト列を保持しない)
+void KeyHasher::addPixels(const void *data, size_t len)
+{
+    mixBytes(data, len, [this](uint64_t v) {
+        hash_    = mix(hash_, v);
+        content_ = mix(content_, v, HASH_MUL3, HASH_MUL1);
+    });
+    len_ += len;
+}
+
+/*************************************************
+ * KeyHasher &add(Mat img)
+ * Mat img : 画像 (カーネルや画素ごとのパラメータなど)
+ *
+ * 機能 : 画像の大きさ、型、画素値をハッシュ値に混ぜる
+ *
+ * return : KeyHasher & 自身
+ *************************************************/
+KeyHasher &KeyHasher::add(Mat img)
+{
+    add(img.rows).add(img.cols).add(img.type());
+    for (int32_t y = 0; y < img.rows; y++) {
+        addPixels(img.ptr<uint8_t>(y), img.cols * img.elemSize());
+    }
+    return *this;
+}
+
+/*************************************************
+ * KeyHasher &addImage(Mat img, int32_t height, int32_t width)
+ * Mat img : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ *
+ * 機能 : 入力画像の画素値をハッシュ値に混ぜる
+ *
+ * return : KeyHasher & 自身
+ *************************************************/
+KeyHasher &KeyHasher::addImage(Mat img, int32_t height, int32_t width)
+{
+    add(height).add(width);
+    for (int32_t y = 0; y < height; y++) {
+        addPixels(img.ptr<uint8_t>(y), static_cast<size_t>(width) * 3);
+    }
+    return *this;
+}
+
+/*************************************************
+ * uint64_t value() const
+ *
+ * 機能 : ハッシュ値を求める (長さを混ぜてビットを拡散する)
+ *
+ * return : uint64_t ハッシュ値
+ *************************************************/
+uint64_t KeyHasher::value() const
+{
+    uint64_t h = mix(hash_, len_);
+    h ^= h >> 33;
+    h *= HASH_MUL2;
+    h ^= h >> 29;
+    return h;
+}
+
+/*************************************************
+ * Key key() const
+ *
+ * 機能 : キャッシュのキーを求める (ハッシュ値、画素値以外のバイト列、画素値のハッシュ値)
+ *
+ * return : Key キー
+ *************************************************/
+Key KeyHasher::key() const
+{
+    return Key{value(), fields_, mix(content_, len_, HASH_MUL3, HASH_MUL1)};
+}
+
+/*************************************************
+ * ResultCache(size_t memLimitBytes, std::string spillDir)
+ * size_t memLimitBytes : メモリ上に保持する画像の合計バイト数の上限
+ * std::string spillDir : 追い出した結果を書き出すディレクトリ (空の場合は破棄)
+ *************************************************/
+ResultCache::ResultCache(size_t memLimitBytes, std::string spillDir)
+    : memLimit_(memLimitBytes), spillDir_(std::move(spillDir))
+{
+    if (!spillDir_.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(spillDir_, ec);
+        if (ec) {
+            spillDir_.clear();
+        }
+    }
+}
+
+/*************************************************
+ * bool lookup(const Key &key, Mat outImg, int32_t height, int32_t width)
+ * const Key &key : 入力画素と処理内容のキー
+ * Mat outImg : 出力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ *
+ * 機能 : キャッシュから結果を探して出力画像にコピー
+ *        メモリになければディスクを探し、見つかればメモリに戻す
+ *        ハッシュ値が同じでもキー全体が異なる結果はミスとする
+ *
+ * return : bool ヒットした場合はtrue
+ *************************************************/
+bool ResultCache::lookup(const Key &key, Mat outImg, int32_t height, int32_t width)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Mat                         img;
+
+    auto it = index_.find(key.hash);
+    if (it != index_.end()) {
+        if (it->second->key != key) {
+            stats_.misses++;
+            return false;
+        }
+
+        // 最近使った結果として先頭に移動
+        lru_.splice(lru_.begin(), lru_, it->second);
+        img = it->second->img;
+    } else if (loadSpill(key, img)) {
+        stats_.diskHits++;
+        insert(key, img);
+    }
+
+    if (img.empty() || img.rows != height || img.cols != width || img.type() != outImg.type()) {
+        stats_.misses++;
+        return false;
+    }
+
+    stats_.hits++;
+    for (int32_t y = 0; y < height; y++) {
+        std::memcpy(outImg.ptr<uint8_t>(y), img.ptr<uint8_t>(y), width * img.elemSize());
+    }
+    return true;
+}
+
+/*************************************************
+ * void store(const Key &key, Mat img, int32_t height, int32_t width)
+ * const Key &key : 入力画素と処理内容のキー
+ * Mat img : 処理結果の画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ *
+ * 機能 : 処理結果のコピーをキャッシュに保存 (上限を超えた分は古いものから追い出す)
+ *        ハッシュ値が同じ結果があれば置き換える
+ *
+ * return : void
+ *************************************************/
+void ResultCache::store(const Key &key, Mat img, int32_t height, int32_t width)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key.hash);
+    if (it != index_.end()) {
+        stats_.memBytes -= imageBytes(it->second->img);
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    insert(key, img(Rect(0, 0, width, height)).clone());
+}
+
+/*************************************************
+ * CacheStats stats() const
+ *
+ * 機能 : ヒット、ミス、追い出しの回数とメモリ使用量を取得
+ *
+ * return : CacheStats 統計
+ *************************************************/
+CacheStats ResultCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    CacheStats                  s = stats_;
+    s.entries                     = lru_.size();
+    return s;
+}
+
+/*************************************************
+ * void clear()
+ *
+ * 機能 : メモリ上とディスク上の結果をすべて削除 (統計はそのまま)
+ *
+ * return : void
+ *************************************************/
+void ResultCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    lru_.clear();
+    index_.clear();
+    stats_.memBytes = 0;
+
+    if (!spillDir_.empty()) {
+        std::error_code ec;
+        for (const auto &file : std::filesystem::directory_iterator(spillDir_, ec)) {
+            if (file.path().extension() == ".bin") {
+                std::filesystem::remove(file.path(), ec);
+            }
+        }
+    }
+}
+
+// メモリの先頭に追加し、上限を超えたら追い出す
+void ResultCache::insert(const Key &key, Mat img)
+{
+    lru_.push_front(Entry{key, img});
+    index_[key.hash] = lru_.begin();
+    stats_.memBytes += imageBytes(img);
+
+    // 最近使った1つは上限を超えても残す
+    while (stats_.memBytes > memLimit_ && lru_.size() > 1) {
+        evict();
+    }
+}
+
+// 最も古い結果をメモリから追い出す (ディレクトリがあれば、キー全体と画像を書き出す)
+void ResultCache::evict()
+{
+    Entry &victim = lru_.back();
+
+    if (!spillDir_.empty()) {
+        std::ofstream ofs(spillPath(victim.key.hash), std::ios::binary | std::ios::trunc);
+        int32_t       header[4] = {static_cast<int32_t>(SPILL_MAGIC), victim.img.rows, victim.img.cols,
+                                   victim.img.type()};
+        uint64_t      content   = victim.key.content;
+        uint64_t      fieldsLen = victim.key.fields.size();
+        ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+        ofs.write(reinterpret_cast<const char *>(&content), sizeof(content));
+        ofs.write(reinterpret_cast<const char *>(&fieldsLen), sizeof(fieldsLen));
+        ofs.write(victim.key.fields.data(), static_cast<std::streamsize>(fieldsLen));
+        for (int32_t y = 0; y < victim.img.rows; y++) {
+            ofs.write(victim.img.ptr<char>(y), victim.img.cols * victim.img.elemSize());
+        }
+        if (ofs) {
+            stats_.spills++;
+        }
+    }
+
+    stats_.evictions++;
+    stats_.memBytes -= imageBytes(victim.img);
+    index_.erase(victim.key.hash);
+    lru_.pop_back();
+}
+
+std::string ResultCache::spillPath(uint64_t hash) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(spillDir_) / name).string();
+}
+
+// ディスクに書き出した結果を読み込む (キー全体が一致する場合のみ)
+// 書式が壊れたファイル (型、大きさ、ファイルサイズの不一致) は削除する
+bool ResultCache::loadSpill(const Key &key, Mat &img) const
+{
+    if (spillDir_.empty()) {
+        return false;
+    }
+
+    std::string     path = spillPath(key.hash);
+    std::error_code ec;
+    uint64_t        fileSize = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+
+    std::ifstream ifs(path, std::ios::binary);
+    int32_t       header[4];
+    uint64_t      content   = 0;
+    uint64_t      fieldsLen = 0;
+    if (!ifs.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        !ifs.read(reinterpret_cast<char *>(&content), sizeof(content)) ||
+        !ifs.read(reinterpret_cast<char *>(&fieldsLen), sizeof(fieldsLen)) ||
+        header[0] != static_cast<int32_t>(SPILL_MAGIC) || header[1] <= 0 || header[2] <= 0 || header[3] != CV_8UC3 ||
+        fieldsLen > fileSize ||
+        fileSize != SPILL_HEADER_BYTES + fieldsLen + static_cast<uint64_t>(header[1]) * header[2] * 3) {
+        ifs.close();
+        std::filesystem::remove(path, ec);
+        return false;
+    }
+
+    // ハッシュ値だけが同じ別の結果 (ファイルは残す)
+    if (content != key.content || fieldsLen != key.fields.size()) {
+        return false;
+    }
+    std::string fields(fieldsLen, '\0');
+    if (!ifs.read(fields.data(), static_cast<std::streamsize>(fieldsLen)) || fields != key.fields) {
+        return false;
+    }
+
+    img = Mat{header[1], header[2], CV_8UC3};
+    for (int32_t y = 0; y < img.rows; y++) {
+        if (!ifs.read(img.ptr<char>(y), img.cols * img.elemSize())) {
+            img = Mat{};
+            ifs.close();
+            std::filesystem::remove(path, ec);
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace cache
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+using namespace cv;
+
+namespace cache {
+
+// キャッシュのキー (索引はhashで引き、ヒットしたときはキー全体を比べてハッシュ値の衝突を除く)
+struct Key
+{
+    uint64_t    hash = 0;     // 索引に使うハッシュ値
+    std::string fields;       // 画素値以外の内容 (処理の種類、パラメータ、端の処理、画像の大きさ) のバイト列
+    uint64_t    content = 0;  // 画素値のハッシュ値 (hashとは別の乗数で求める)
+
+    bool operator==(const Key &other) const
+    {
+        return hash == other.hash && content == other.content && fields == other.fields;
+    }
+    bool operator!=(const Key &other) const { return !(*this == other); }
+};
+
+// 入力画素と処理内容のハッシュ値 (キャッシュのキー)
+class KeyHasher
+{
+public:
+    KeyHasher &add(const void *data, size_t len);
+    KeyHasher &add(const std::string &str) { return add(str.data(), str.size()).add(str.size()); }
+    KeyHasher &add(Mat img);  // 画素値と大きさ、型
+    KeyHasher &addImage(Mat img, int32_t height, int32_t width);
+
+    // 数値や列挙型のパラメータ
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>>
+    KeyHasher &add(T value)
+    {
+        return add(&value, sizeof(value));
+    }
+
+    uint64_t value() const;
+    Key      key() const;
+
+private:
+    void addPixels(const void *data, size_t len);
+
+    uint64_t    hash_    = 0x243F6A8885A308D3ull;
+    uint64_t    content_ = 0x13198A2E03707344ull;
+    uint64_t    len_     = 0;
+    std::string fields_;
+};
+
+// キャッシュの統計
+struct CacheStats
+{
+    uint64_t hits      = 0;  // メモリまたはディスクのヒット
+    uint64_t diskHits  = 0;  // ディスクからの読み込みでヒット
+    uint64_t misses    = 0;
+    uint64_t evictions = 0;  // メモリから追い出した数
+    uint64_t spills    = 0;  // 追い出してディスクに書き込んだ数
+    size_t   memBytes  = 0;  // メモリ上の画像のバイト数
+    size_t   entries   = 0;  // メモリ上の画像の数
+};
+
+// 処理結果のキャッシュ (メモリ上のLRU、あふれた結果はディレクトリに書き出す)
+class ResultCache
+{
+public:
+    explicit ResultCache(size_t memLimitBytes, std::string spillDir = "");
+
+    bool       lookup(const Key &key, Mat outImg, int32_t height, int32_t width);
+    void       store(const Key &key, Mat img, int32_t height, int32_t width);
+    CacheStats stats() const;
+    void       clear();
+
+    /*************************************************
+     * void process(const Key &key, Mat outImg, int32_t height, int32_t width, Fn fn)
+     * const Key &key : KeyHasherで求めた入力画素と処理内容のキー
+     * Mat outImg : 出力画像
+     * int32_t height : 高さ
+     * int32_t width : 横幅
+     * Fn fn : キャッシュにない場合に実行する処理 (outImgに書き込む)
+     *
+     * 機能 : キャッシュにあれば結果をコピーして処理を省略し、なければ処理して結果を保存
+     *
+     * return : void
+     *************************************************/
+    template <typename Fn>
+    void process(const Key &key, Mat outImg, int32_t height, int32_t width, Fn fn)
+    {
+        if (lookup(key, outImg, height, width)) {
+            return;
+        }
+        fn();
+        store(key, outImg, height, width);
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Mat img;
+    };
+
+    std::string spillPath(uint64_t hash) const;
+    bool        loadSpill(const Key &key, Mat &img) const;
+    void        insert(const Key &key, Mat img);
+    void        evict();
+
+    size_t                                                   memLimit_;
+    std::string                                              spillDir_;
+    std::list<Entry>                                         lru_;  // 先頭が最近使った結果
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;  // Key::hashから結果を引く
+    CacheStats                                               stats_;
+    mutable std::mutex                                       mutex_;
+};
+
+}  // namespace cache
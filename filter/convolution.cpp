@@ -0,0 +1,652 @@
+#include "filter.h"
+#include "../param.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace filter {
+
+namespace {
+constexpr double  FFT_COST_FACTOR = 1.0;  // FFTの1点あたりの相対コスト (積和1回を1とする)
+constexpr int32_t FFT_MAX_TILE    = 128;  // キャッシュに収まるFFTのタイルサイズの上限
+
+// 1次元のタップ (カーネル内の位置, 係数)
+struct Tap
+{
+    int32_t pos;
+    float   weight;
+};
+
+/*************************************************
+ * std::vector<int32_t> makeColumnTable(int32_t width, int32_t kw, BorderType borderType)
+ * int32_t width : 横幅
+ * int32_t kw : カーネルの横幅
+ * BorderType borderType : 画像の端の処理
+ *
+ * 機能 : 端の処理をした列オフセット表を作成 (要素iは列i - kw / 2の画素)
+ *
+ * return : std::vector<int32_t> 列オフセット表 (Constantの範囲外は-1)
+ *************************************************/
+std::vector<int32_t> makeColumnTable(int32_t width, int32_t kw, BorderType borderType)
+{
+    std::vector<int32_t> xTab(width + kw - 1);
+    for (int32_t i = 0; i < width + kw - 1; i++) {
+        int32_t srcX = borderIndex(i - kw / 2, width, borderType);
+        xTab[i]      = srcX >= 0 ? srcX * 3 : -1;
+    }
+    return xTab;
+}
+
+/*************************************************
+ * bool splitKernel(const Mat &kernel, std::vector<double> &col, std::vector<double> &row)
+ * const Mat &kernel : カーネル (CV_64FC1)
+ * std::vector<double> &col : 縦方向の1次元カーネル
+ * std::vector<double> &row : 横方向の1次元カーネル
+ *
+ * 機能 : カーネルが縦と横の1次元カーネルの積(ランク1)に分離できるか判定する
+ *        全要素が整数の場合は整数の積に分解し、畳み込み結果が直接計算と一致するようにする
+ *
+ * return : bool 分離できればtrue
+ *************************************************/
+bool splitKernel(const Mat &kernel, std::vector<double> &col, std::vector<double> &row)
+{
+    int32_t kh = kernel.rows;
+    int32_t kw = kernel.cols;
+
+    // 絶対値が最大の要素を基準にする
+    int32_t i0 = 0, j0 = 0;
+    double  maxAbs  = 0.0;
+    bool    integer = true;
+    for (int32_t i = 0; i < kh; i++) {
+        for (int32_t j = 0; j < kw; j++) {
+            double v = kernel.at<double>(i, j);
+            if (std::abs(v) > maxAbs) {
+                maxAbs = std::abs(v);
+                i0     = i;
+                j0     = j;
+            }
+            integer = integer && v == std::round(v);
+        }
+    }
+    if (maxAbs == 0.0) {
+        return false;
+    }
+
+    std::vector<double> c(kh), r(kw);
+    if (integer) {
+        // 基準行を最大公約数で割った原始ベクトルを横方向にする (ランク1なら縦方向も整数になる)
+        int64_t g = 0;
+        for (int32_t j = 0; j < kw; j++) {
+            g = std::gcd(g, static_cast<int64_t>(kernel.at<double>(i0, j)));
+        }
+        for (int32_t j = 0; j < kw; j++) {
+            r[j] = kernel.at<double>(i0, j) / g;
+        }
+        for (int32_t i = 0; i < kh; i++) {
+            c[i] = kernel.at<double>(i, j0) / r[j0];
+            if (c[i] != std::round(c[i])) {
+                return false;
+            }
+        }
+    } else {
+        for (int32_t j = 0; j < kw; j++) {
+            r[j] = kernel.at<double>(i0, j);
+        }
+        for (int32_t i = 0; i < kh; i++) {
+            c[i] = kernel.at<double>(i, j0) / r[j0];
+        }
+    }
+
+    // 外積が元のカーネルと一致するか確認
+    double eps = integer ? 0.0 : maxAbs * 1e-6;
+    for (int32_t i = 0; i < kh; i++) {
+        for (int32_t j = 0; j < kw; j++) {
+            if (std::abs(c[i] * r[j] - kernel.at<double>(i, j)) > eps) {
+                return false;
+            }
+        }
+    }
+
+    col = c;
+    row = r;
+    return true;
+}
+
+/*************************************************
+ * std::vector<Tap> makeTaps(const double *coeffs, int32_t n)
+ * const double *coeffs : 1次元カーネル
+ * int32_t n : 要素数
+ *
+ * 機能 : 係数が0でないタップだけを取り出す
+ *
+ * return : std::vector<Tap> タップの一覧
+ *************************************************/
+std::vector<Tap> makeTaps(const double *coeffs, int32_t n)
+{
+    std::vector<Tap> taps;
+    for (int32_t i = 0; i < n; i++) {
+        if (coeffs[i] != 0.0) {
+            taps.push_back({i, static_cast<float>(coeffs[i])});
+        }
+    }
+    return taps;
+}
+
+/*************************************************
+ * void accumulateRow(const uint8_t *src, int32_t width, const std::vector<Tap> &taps, int32_t kw,
+ *                    const std::vector<int32_t> &xTab, const uint8_t *constPix, float *dst)
+ * const uint8_t *src : 入力画像の1行
+ * int32_t width : 横幅
+ * const std::vector<Tap> &taps : 横方向のタップ
+ * int32_t kw : カーネルの横幅
+ * const std::vector<int32_t> &xTab : 端の処理済みの列オフセット表 (-1はconstPixを参照)
+ * const uint8_t *constPix : BorderType::Constantの画素値
+ * float *dst : 積和の加算先 (width * 3要素)
+ *
+ * 機能 : 1行分の横方向の積和をdstに加算する
+ *        端の処理は左右の端の列だけで行い、内側の列は連続したメモリを直接参照する
+ *
+ * return : void
+ *************************************************/
+void accumulateRow(const uint8_t *src, int32_t width, const std::vector<Tap> &taps, int32_t kw,
+                   const std::vector<int32_t> &xTab, const uint8_t *constPix, float *dst)
+{
+    int32_t anchor = kw / 2;
+    int32_t x0     = std::min(anchor, width);
+    int32_t x1     = std::max(x0, width - (kw - 1 - anchor));
+
+    // 画像の端の処理
+    auto accumulateEdge = [&](const Tap &tap, int32_t begin, int32_t end) {
+        for (int32_t x = begin; x < end; x++) {
+            int32_t        offset = xTab[x + tap.pos];
+            const uint8_t *pix    = offset >= 0 ? src + offset : constPix;
+            dst[x * 3 + BLUE] += tap.weight * pix[BLUE];
+            dst[x * 3 + GREEN] += tap.weight * pix[GREEN];
+            dst[x * 3 + RED] += tap.weight * pix[RED];
+        }
+    };
+
+    for (const Tap &tap : taps) {
+        accumulateEdge(tap, 0, x0);
+        accumulateEdge(tap, x1, width);
+
+        // 内側
+        const uint8_t *shifted = src + (tap.pos - anchor) * 3;
+        for (int32_t i = x0 * 3; i < x1 * 3; i++) {
+            dst[i] += tap.weight * shifted[i];
+        }
+    }
+}
+
+/*************************************************
+ * int32_t chooseFftTile(int32_t height, int32_t width, int32_t kh, int32_t kw, int32_t taps)
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t kh : カーネルの高さ
+ * int32_t kw : カーネルの横幅
+ * int32_t taps : カーネルの0でない要素数
+ *
+ * 機能 : 直接計算とFFT(重畳加算法)の処理量を見積もり、FFTのタイルサイズを決める
+ *        タイルはキャッシュに収まるFFT_MAX_TILE以下から選ぶ (カーネルが大きい場合は最小のサイズ)
+ *
+ * return : int32_t タイルサイズ (直接計算の方が速い場合は0)
+ *************************************************/
+int32_t chooseFftTile(int32_t height, int32_t width, int32_t kh, int32_t kw, int32_t taps)
+{
+    int32_t n        = std::max(kh, kw);
+    double  bestCost = static_cast<double>(taps) * height * width;
+    int32_t bestTile = 0;
+
+    for (int32_t block = 16; block <= 1024; block *= 2) {
+        int32_t tile = getOptimalDFTSize(block + n - 1);
+        if (tile > FFT_MAX_TILE && block > 16) {
+            break;
+        }
+
+        // 順変換と逆変換の2回分のFFTと、スペクトルの積
+        int32_t blockSize = tile - n + 1;
+        double  tileCost  = 2.0 * FFT_COST_FACTOR * tile * tile * std::log2(static_cast<double>(tile) * tile) +
+                          6.0 * tile * tile;
+        double tiles = std::ceil((height + kh - 1.0) / blockSize) * std::ceil((width + kw - 1.0) / blockSize);
+
+        if (tiles * tileCost < bestCost) {
+            bestCost = tiles * tileCost;
+            bestTile = tile;
+        }
+    }
+    return bestTile;
+}
+
+/*************************************************
+ * void fftConvolveRows(BorderRows &border, const std::vector<int32_t> &xTab, Vec3b borderValue, int32_t height,
+ *                      int32_t width, const Mat &kernel, int32_t tile, RowFn rowFn)
+ * BorderRows &border : 端の処理をした入力画像の行
+ * const std::vector<int32_t> &xTab : 端の処理をした列オフセット表
+ * Vec3b borderValue : BorderType::Constantの画素値
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * const Mat &kernel : カーネル (CV_64FC1)
+ * int32_t tile : FFTのタイルサイズ
+ * RowFn rowFn : 1行分の積和を受け取る関数 (y, const float *row)
+ *
+ * 機能 : 重畳加算法(overlap-add)によるFFT畳み込み
+ *        端の処理をした画像をブロックに分け、ブロックごとにFFTで畳み込んで足し合わせる
+ *        ブロック1段分の結果だけを保持し、確定した行から順にrowFnへ渡す
+ *
+ * return : void
+ *************************************************/
+template <typename RowFn>
+void fftConvolveRows(BorderRows &border, const std::vector<int32_t> &xTab, Vec3b borderValue, int32_t height,
+                     int32_t width, const Mat &kernel, int32_t tile, RowFn rowFn)
+{
+    int32_t kh        = kernel.rows;
+    int32_t kw        = kernel.cols;
+    int32_t anchorY   = kh / 2;
+    int32_t blockSize = tile - std::max(kh, kw) + 1;
+    int32_t padH      = height + kh - 1;  // 端の処理をした画像の高さ
+    int32_t padW      = width + kw - 1;   // 端の処理をした画像の横幅
+    int32_t rowLen    = width * 3;
+
+    // 相関を畳み込みで求めるため、反転したカーネルのスペクトルを作成
+    Mat kernelTile = Mat{tile, tile, CV_32FC1, Scalar(0)};
+    for (int32_t i = 0; i < kh; i++) {
+        for (int32_t j = 0; j < kw; j++) {
+            kernelTile.at<float>(i, j) = static_cast<float>(kernel.at<double>(kh - 1 - i, kw - 1 - j));
+        }
+    }
+    Mat kernelSpec;
+    dft(kernelTile, kernelSpec, DFT_COMPLEX_OUTPUT);
+
+    // ブロック1段分の畳み込み結果 (出力画像の列のみ)
+    int32_t            bandH = blockSize + kh - 1;
+    std::vector<float> band(static_cast<size_t>(bandH) * rowLen, 0.f);
+
+    Mat tileImg = Mat{tile, tile, CV_32FC1};
+    Mat spec, result;
+
+    for (int32_t by = 0; by < padH; by += blockSize) {
+        int32_t rows = std::min(blockSize, padH - by);
+
+        for (int32_t bx = 0; bx < padW; bx += blockSize) {
+            int32_t cols = std::min(blockSize, padW - bx);
+
+            for (int32_t c = 0; c < 3; c++) {
+                // ブロックを切り出し、残りを0で埋める
+                tileImg.setTo(Scalar(0));
+                for (int32_t r = 0; r < rows; r++) {
+                    // 画像の端の処理
+                    const uint8_t *src = border.row(by + r - anchorY);
+                    float         *dst = tileImg.ptr<float>(r);
+                    for (int32_t cc = 0; cc < cols; cc++) {
+                        int32_t offset = xTab[bx + cc];
+                        dst[cc]        = offset >= 0 ? src[offset + c] : borderValue[c];
+                    }
+                }
+
+                // ブロックとカーネルの畳み込み
+                dft(tileImg, spec, DFT_COMPLEX_OUTPUT);
+                mulSpectrums(spec, kernelSpec, spec, 0);
+                dft(spec, result, DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT);
+
+                // 結果を足し合わせる (畳み込みの(kh - 1, kw - 1)が出力画像の(0, 0)に対応)
+                for (int32_t r = 0; r < rows + kh - 1; r++) {
+                    const float *res = result.ptr<float>(r);
+                    float       *dst = &band[static_cast<size_t>(r) * rowLen];
+                    int32_t      x0  = std::max(0, kw - 1 - bx);
+                    int32_t      x1  = std::min(cols + kw - 1, width + kw - 1 - bx);
+                    for (int32_t cc = x0; cc < x1; cc++) {
+                        dst[(bx + cc - (kw - 1)) * 3 + c] += res[cc];
+                    }
+                }
+            }
+        }
+
+        // 以降のブロックが加算されない行を出力
+        for (int32_t r = 0; r < blockSize; r++) {
+            int32_t y = by + r - (kh - 1);
+            if (y >= 0 && y < height) {
+                border.retire(y);
+                rowFn(y, &band[static_cast<size_t>(r) * rowLen]);
+            }
+        }
+
+        // 次の段のために残りの行を先頭に移動
+        std::copy(band.begin() + static_cast<size_t>(blockSize) * rowLen, band.end(), band.begin());
+        std::fill(band.end() - static_cast<size_t>(blockSize) * rowLen, band.end(), 0.f);
+    }
+}
+
+// 1つのカーネルの積和を1行ずつ求める
+class RowConvolver
+{
+public:
+    /*************************************************
+     * RowConvolver(const Mat &kernel, int32_t width, const BorderRows &border, const std::vector<int32_t> &xTab,
+     *              Vec3b borderValue)
+     * const Mat &kernel : カーネル (CV_64FC1)
+     * int32_t width : 横幅
+     * const BorderRows &border : 端の処理をした入力画像の行
+     * const std::vector<int32_t> &xTab : 端の処理をした列オフセット表
+     * Vec3b borderValue : BorderType::Constantの画素値
+     *
+     * 分離可能なカーネルは横と縦の1次元の積和に分けて行い、N^2回の積和を2N回に減らす
+     *************************************************/
+    RowConvolver(const Mat &kernel, int32_t width, const BorderRows &border, const std::vector<int32_t> &xTab,
+                 Vec3b borderValue)
+        : kh_(kernel.rows), kw_(kernel.cols), width_(width), border_(border), xTab_(xTab), borderValue_(borderValue)
+    {
+        std::vector<double> col, row;
+
+        separable_ = splitKernel(kernel, col, row);
+        if (separable_) {
+            colTaps_ = makeTaps(col.data(), kh_);
+            rowTaps_.push_back(makeTaps(row.data(), kw_));
+
+            // 横方向の積和をkh行分だけ保持するリングバッファ (端の外側も含めた行番号 % kh の位置に格納)
+            ring_.resize(static_cast<size_t>(kh_) * width_ * 3);
+            ringRow_.assign(kh_, INT32_MIN);
+        } else {
+            for (int32_t i = 0; i < kh_; i++) {
+                rowTaps_.push_back(makeTaps(kernel.ptr<double>(i), kw_));
+                taps_ += static_cast<int32_t>(rowTaps_[i].size());
+            }
+        }
+    }
+
+    bool    separable() const { return separable_; }
+    int32_t taps() const { return taps_; }
+
+    // 出力画像のy行目の積和をdstに求める
+    void compute(int32_t y, float *dst)
+    {
+        int32_t anchorY = kh_ / 2;
+        int32_t rowLen  = width_ * 3;
+
+        std::fill(dst, dst + rowLen, 0.f);
+
+        if (!separable_) {
+            for (int32_t i = 0; i < kh_; i++) {
+                if (!rowTaps_[i].empty()) {
+                    accumulateRow(border_.row(y + i - anchorY), width_, rowTaps_[i], kw_, xTab_, &borderValue_[0], dst);
+                }
+            }
+            return;
+        }
+
+        for (const Tap &tap : colTaps_) {
+            int32_t srcY = y + tap.pos - anchorY;
+            int32_t slot = (srcY % kh_ + kh_) % kh_;
+            float  *tmp  = &ring_[static_cast<size_t>(slot) * rowLen];
+
+            // 横方向の積和 (未計算の行のみ)
+            if (ringRow_[slot] != srcY) {
+                std::fill(tmp, tmp + rowLen, 0.f);
+                accumulateRow(border_.row(srcY), width_, rowTaps_[0], kw_, xTab_, &borderValue_[0], tmp);
+                ringRow_[slot] = srcY;
+            }
+
+            // 縦方向の積和
+            for (int32_t i = 0; i < rowLen; i++) {
+                dst[i] += tap.weight * tmp[i];
+            }
+        }
+    }
+
+private:
+    int32_t                       kh_;
+    int32_t                       kw_;
+    int32_t                       width_;
+    const BorderRows             &border_;
+    const std::vector<int32_t>   &xTab_;
+    Vec3b                         borderValue_;
+    bool                          separable_ = false;
+    int32_t                       taps_      = 0;
+    std::vector<Tap>              colTaps_;
+    std::vector<std::vector<Tap>> rowTaps_;
+    std::vector<float>            ring_;
+    std::vector<int32_t>          ringRow_;
+};
+
+/*************************************************
+ * void convolveRows(Mat inImg, int32_t height, int32_t width, const Mat &kernel, BorderType borderType,
+ *                   Vec3b borderValue, bool inPlace, const TuneConfig &config, RowFn rowFn)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * const Mat &kernel : カーネル (CV_64FC1)
+ * BorderType borderType : 画像の端の処理
+ * Vec3b borderValue : BorderType::Constantの画素値
+ * bool inPlace : rowFnが入力画像のy行目を上書きする場合はtrue
+ * const TuneConfig &config : スレッド数と帯の行数 (直接計算のみ、インプレース処理では1スレッド)、
+ *                             Variant::DirectではFFTを使わない
+ * RowFn rowFn : 1行分の積和を受け取る関数 (y, const float *row)、複数のスレッドから異なる行で呼ばれる
+ *
+ * 機能 : 画像とカーネルの積和を1行ずつ求める
+ *        端の処理は行の先頭の選択と左右の端の列だけで行い、内側の画素では行わない
+ *        分離できない大きなカーネルは、処理量の見積もりがFFTの方が小さければFFTで求める
+ *        インプレース処理では上書きする前の行を数行分だけ保存する
+ *
+ * return : void
+ *************************************************/
+template <typename RowFn>
+void convolveRows(Mat inImg, int32_t height, int32_t width, const Mat &kernel, BorderType borderType, Vec3b borderValue,
+                  bool inPlace, const TuneConfig &config, RowFn rowFn)
+{
+    int32_t              kh   = kernel.rows;
+    std::vector<int32_t> xTab = makeColumnTable(width, kernel.cols, borderType);
+
+    // 直接計算の積和の回数からFFTを使うか決める
+    // (FFTの丸め誤差は画像の大きさとブロックの位置で変わるため、Variant::Directでは常に直接計算)
+    BorderRows   probe(inImg, height, width, borderType, borderValue);
+    RowConvolver probeConv(kernel, width, probe, xTab, borderValue);
+    bool         direct = probeConv.separable() || config.variant == Variant::Direct;
+    int32_t      tile   = direct ? 0 : chooseFftTile(height, width, kh, kernel.cols, probeConv.taps());
+    if (tile > 0) {
+        // FFTはブロック1段分の行を読んでから出力するため、上書きされる行をブロック1段とカーネル分だけ保存する
+        BorderRows border(inImg, height, width, borderType, borderValue, inPlace, tile + kh);
+        fftConvolveRows(border, xTab, borderValue, height, width, kernel, tile, rowFn);
+        return;
+    }
+
+    forEachStrip(height, config.tileRows, inPlace ? 1 : config.threadNum, [&](int32_t y0, int32_t y1) {
+        BorderRows         border(inImg, height, width, borderType, borderValue, inPlace, kh);
+        RowConvolver       conv(kernel, width, border, xTab, borderValue);
+        std::vector<float> dst(width * 3);
+
+        for (int32_t y = y0; y < y1; y++) {
+            conv.compute(y, dst.data());
+            border.retire(y);
+            rowFn(y, dst.data());
+        }
+    });
+}
+
+#ifdef __SSE2__
+/*************************************************
+ * int32_t gradientMagnitudeSimd(const float *gx, const float *gy, int32_t n, uint8_t *dst)
+ * const float *gx : 横方向の積和
+ * const float *gy : 縦方向の積和
+ * int32_t n : 要素数
+ * uint8_t *dst : 勾配の大きさ (0~255に収めて切り捨て)
+ *
+ * 機能 : 勾配の大きさを4要素ずつ求める (スカラーと同じく倍精度で計算するため結果は同じ)
+ *
+ * return : int32_t 求め終わった要素数
+ *************************************************/
+int32_t gradientMagnitudeSimd(const float *gx, const float *gy, int32_t n, uint8_t *dst)
+{
+    const __m128d maxVal = _mm_set1_pd(255.0);
+    int32_t       i      = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 fx = _mm_loadu_ps(gx + i);
+        __m128 fy = _mm_loadu_ps(gy + i);
+
+        // 下位2要素と上位2要素を倍精度に変換
+        __m128d x0 = _mm_cvtps_pd(fx);
+        __m128d x1 = _mm_cvtps_pd(_mm_movehl_ps(fx, fx));
+        __m128d y0 = _mm_cvtps_pd(fy);
+        __m128d y1 = _mm_cvtps_pd(_mm_movehl_ps(fy, fy));
+
+        __m128d m0 = _mm_min_pd(_mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(x0, x0), _mm_mul_pd(y0, y0))), maxVal);
+        __m128d m1 = _mm_min_pd(_mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(x1, x1), _mm_mul_pd(y1, y1))), maxVal);
+
+        // 切り捨てて32bit整数 -> 16bit -> 8bitに詰める (0~255のため飽和しない)
+        __m128i v = _mm_unpacklo_epi64(_mm_cvttpd_epi32(m0), _mm_cvttpd_epi32(m1));
+        v         = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+
+        int32_t packed = _mm_cvtsi128_si32(v);
+        std::memcpy(dst + i, &packed, 4);
+    }
+    return i;
+}
+#endif
+}  // namespace
+
+/*************************************************
+ * void convolveRaw(Mat inImg, int32_t height, int32_t width, Mat kernel, Mat rawImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat kernel : カーネル (CV_32SC1, CV_32FC1, CV_64FC1のいずれか、中心は(cols / 2, rows / 2))
+ * Mat rawImg : 積和の出力画像 (CV_32FC3、正規化や0~255への丸めはしない)
+ *
+ * 機能 : 任意サイズのカーネルによる畳み込み(相関)処理 (端の処理はsetBorderで指定)
+ *        分離可能なカーネル(Sobel、Prewitt、二項分布など)は自動で1次元2回の処理に切り替える
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::convolveRaw(Mat inImg, int32_t height, int32_t width, Mat kernel, Mat rawImg)
+{
+    Mat kernel64;
+    kernel.convertTo(kernel64, CV_64F);
+
+    TuneConfig config = tuning(IpsType::Convolution, height, width);
+    convolveRows(inImg, height, width, kernel64, borderType_, borderValue_, false, config,
+                 [&](int32_t y, const float *row) { std::copy(row, row + width * 3, rawImg.ptr<float>(y)); });
+}
+
+/*************************************************
+ * void convolve(Mat inImg, int32_t height, int32_t width, Mat kernel, double divisor, double bias, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat kernel : カーネル (CV_32SC1, CV_32FC1, CV_64FC1のいずれか、中心は(cols / 2, rows / 2))
+ * double divisor : 除数
+ * double bias : 加算値
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 任意サイズのカーネルによる畳み込み(相関)処理 (端の処理はsetBorderで指定)
+ *        出力は 積和 / divisor (0方向に切り捨て) + bias を0~255に収めた値
+ *        (整数カーネルでは既存のフィルタの整数除算と同じ結果になる)
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::convolve(Mat inImg, int32_t height, int32_t width, Mat kernel, double divisor, double bias,
+                              Mat outImg)
+{
+    convolveTuned(inImg, height, width, kernel, divisor, bias, tuning(IpsType::Convolution, height, width), outImg);
+}
+
+/*************************************************
+ * void convolveTuned(Mat inImg, int32_t height, int32_t width, Mat kernel, double divisor, double bias,
+ *                    TuneConfig config, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat kernel : カーネル
+ * double divisor : 除数
+ * double bias : 加算値
+ * TuneConfig config : 呼び出し元の処理の実行時の設定
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 呼び出し元の処理の設定で畳み込み処理を行う (処理の内容はconvolveと同じ)
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::convolveTuned(Mat inImg, int32_t height, int32_t width, Mat kernel, double divisor, double bias,
+                                   TuneConfig config, Mat outImg)
+{
+    Mat  kernel64;
+    bool inPlace = inImg.data == outImg.data;
+    kernel.convertTo(kernel64, CV_64F);
+
+    if (divisor == 0.0) {
+        divisor = 1.0;
+    }
+
+    convolveRows(inImg, height, width, kernel64, borderType_, borderValue_, inPlace, config,
+                 [&](int32_t y, const float *row) {
+                     uint8_t *dst = outImg.ptr<uint8_t>(y);
+                     for (int32_t i = 0; i < width * 3; i++) {
+                         // 画素値の正規化、0~255に収める
+                         double v = std::trunc(row[i] / divisor) + bias;
+                         dst[i]   = static_cast<uint8_t>(std::clamp(v, 0., 255.));
+                     }
+                 });
+}
+
+/*************************************************
+ * void gradientFilter(Mat inImg, int32_t height, int32_t width, Mat filter1, Mat filter2, TuneConfig config,
+ *                     Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat filter1 : 横方向のフィルタ
+ * Mat filter2 : 縦方向のフィルタ
+ * TuneConfig config : 呼び出し元の処理の実行時の設定
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 2方向のフィルタの積和から勾配の大きさを求める
+ *        2つのフィルタの積和を1行ずつ同時に求め、そのまま出力画像に書き込む
+ *        Variant::Simdでは勾配の大きさを4要素ずつ求める
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::gradientFilter(Mat inImg, int32_t height, int32_t width, Mat filter1, Mat filter2,
+                                    TuneConfig config, Mat outImg)
+{
+    Mat filterX, filterY;
+    filter1.convertTo(filterX, CV_64F);
+    filter2.convertTo(filterY, CV_64F);
+
+    int32_t              kh      = std::max(filterX.rows, filterY.rows);
+    bool                 inPlace = inImg.data == outImg.data;
+    std::vector<int32_t> xTabX   = makeColumnTable(width, filterX.cols, borderType_);
+    std::vector<int32_t> xTabY   = makeColumnTable(width, filterY.cols, borderType_);
+
+    forEachStrip(height, config.tileRows, inPlace ? 1 : config.threadNum, [&](int32_t y0, int32_t y1) {
+        BorderRows         border(inImg, height, width, borderType_, borderValue_, inPlace, kh);
+        RowConvolver       convX(filterX, width, border, xTabX, borderValue_);
+        RowConvolver       convY(filterY, width, border, xTabY, borderValue_);
+        std::vector<float> gx(width * 3), gy(width * 3);
+
+        for (int32_t y = y0; y < y1; y++) {
+            // 画素値と横フィルタ、縦フィルタの積和
+            convX.compute(y, gx.data());
+            convY.compute(y, gy.data());
+            border.retire(y);
+
+            uint8_t *dst = outImg.ptr<uint8_t>(y);
+            int32_t  i   = 0;
+#ifdef __SSE2__
+            if (config.variant == Variant::Simd) {
+                i = gradientMagnitudeSimd(gx.data(), gy.data(), width * 3, dst);
+            }
+#endif
+            for (; i < width * 3; i++) {
+                // 画素値の平方根、0~255に収める
+                double mag = sqrt(static_cast<double>(gx[i]) * gx[i] + static_cast<double>(gy[i]) * gy[i]);
+                dst[i]     = static_cast<uint8_t>(std::clamp(mag, 0., 255.));
+            }
+        }
+    });
+}
+
+}  // namespace filter
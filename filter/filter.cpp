@@ -1,160 +1,432 @@
 #include "filter.h"
+#include "../integral/integral.h"
 #include "../param.h"
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <iostream>
 #include <numeric>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace filter {
+
+namespace {
+constexpr double  MIN_GRID_SIGMA_SPACE = 4.0;  // バイラテラルグリッドを使う空間方向のσの下限 (画素)
+constexpr double  MAX_RANGE_BINS       = 32;   // バイラテラルグリッドの輝度方向の分割数の上限
+constexpr int32_t HGW_ROWS             = 16;   // 横方向の収縮・膨張でまとめて走査する行数
+
+// 固定のカーネルの行列 (convolveなどはカーネルを書き換えないため、表を直接参照する)
+Mat kernelMat(const int32_t (&kernel)[3][3])
+{
+    return Mat{3, 3, CV_32SC1, const_cast<int32_t *>(&kernel[0][0])};
+}
+
 /*************************************************
- * void equalizationFilter(Mat inImg, int32_t height, int32_t width, uint16_t filterCoeff, Mat outImg)
+ * void blurGrid(std::vector<float> &grid, std::vector<float> &tmp, int32_t gridH, int32_t gridW, int32_t gridD)
+ * std::vector<float> &grid : バイラテラルグリッド (値の総和, 重みの総和)
+ * std::vector<float> &tmp : 作業用バッファ
+ * int32_t gridH : グリッドの高さ
+ * int32_t gridW : グリッドの横幅
+ * int32_t gridD : グリッドの輝度方向の分割数
+ *
+ * 機能 : グリッドの各軸に[1 2 1]/4のぼかしをかける (端はリピート)
+ *
+ * return : void
+ *************************************************/
+void blurGrid(std::vector<float> &grid, std::vector<float> &tmp, int32_t gridH, int32_t gridW, int32_t gridD)
+{
+    const int32_t dims[3]    = {gridH, gridW, gridD};
+    const size_t  strides[3] = {static_cast<size_t>(gridW) * gridD * 2, static_cast<size_t>(gridD) * 2, 2};
+
+    for (int32_t axis = 0; axis < 3; axis++) {
+        tmp = grid;
+        for (int32_t gy = 0; gy < gridH; gy++) {
+            for (int32_t gx = 0; gx < gridW; gx++) {
+                for (int32_t gz = 0; gz < gridD; gz++) {
+                    int32_t pos[3] = {gy, gx, gz};
+                    size_t  idx    = gy * strides[0] + gx * strides[1] + gz * strides[2];
+
+                    // グリッドの端の処理 (リピート)
+                    size_t prev = pos[axis] > 0 ? idx - strides[axis] : idx;
+                    size_t next = pos[axis] < dims[axis] - 1 ? idx + strides[axis] : idx;
+
+                    grid[idx]     = (tmp[prev] + 2.f * tmp[idx] + tmp[next]) * 0.25f;
+                    grid[idx + 1] = (tmp[prev + 1] + 2.f * tmp[idx + 1] + tmp[next + 1]) * 0.25f;
+                }
+            }
+        }
+    }
+}
+
+/*************************************************
+ * void minMaxRow(const uint8_t *a, const uint8_t *b, uint8_t *dst, int32_t n)
+ * const uint8_t *a : 入力配列1
+ * const uint8_t *b : 入力配列2
+ * uint8_t *dst : 出力配列 (a, bと同じでもよい)
+ * int32_t n : 要素数
+ *
+ * 機能 : 要素ごとの最小値(IsMax=false)または最大値(IsMax=true)を求める
+ *        SSE2が使える場合は16画素値ずつまとめて比較する
+ *
+ * return : void
+ *************************************************/
+template <bool IsMax>
+void minMaxRow(const uint8_t *a, const uint8_t *b, uint8_t *dst, int32_t n)
+{
+    int32_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        if constexpr (IsMax) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_max_epu8(va, vb));
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_min_epu8(va, vb));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = IsMax ? std::max(a[i], b[i]) : std::min(a[i], b[i]);
+    }
+}
+
+#ifdef __SSE2__
+/*************************************************
+ * int32_t median3x3Simd(const uint8_t *const rows[3], int32_t width, uint8_t *dst)
+ * const uint8_t *const rows[3] : 上、中央、下の行
+ * int32_t width : 横幅
+ * uint8_t *dst : 出力する行
+ *
+ * 機能 : 内側の画素の3x3の中央値を16画素値ずつ求める
+ *        左右の画素は3バイト隣にあるため、チャンネルごとに同じ位置の値どうしを比較できる
+ *        中央値は19回の最小値・最大値の選択ネットワークで求める (ソートと同じ結果)
+ *
+ * return : int32_t 求め終わった次の画素のx座標 (以降はスカラーで求める)
+ *************************************************/
+int32_t median3x3Simd(const uint8_t *const rows[3], int32_t width, uint8_t *dst)
+{
+    // 選択ネットワークの比較の組 (p[a] <= p[b]に並べ替える)
+    static constexpr int32_t NETWORK[19][2] = {
+        {1, 2}, {4, 5}, {7, 8}, {0, 1}, {3, 4}, {6, 7}, {1, 2}, {4, 5}, {7, 8}, {0, 3},
+        {5, 8}, {4, 7}, {3, 6}, {1, 4}, {2, 5}, {4, 7}, {4, 2}, {6, 4}, {4, 2},
+    };
+
+    // 内側の画素は3 ~ (width - 1) * 3バイト、読み込みは左右に3バイトはみ出す
+    int32_t i = 3;
+    for (; i + 16 <= (width - 1) * 3; i += 16) {
+        __m128i p[9];
+        for (int32_t yy = 0; yy < 3; yy++) {
+            p[yy * 3]     = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[yy] + i - 3));
+            p[yy * 3 + 1] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[yy] + i));
+            p[yy * 3 + 2] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[yy] + i + 3));
+        }
+        for (const auto &pair : NETWORK) {
+            __m128i lo = _mm_min_epu8(p[pair[0]], p[pair[1]]);
+            p[pair[1]] = _mm_max_epu8(p[pair[0]], p[pair[1]]);
+            p[pair[0]] = lo;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), p[4]);
+    }
+
+    // 途中まで求めた画素は求め直す
+    return std::max(i / 3, 1);
+}
+#endif
+
+/*************************************************
+ * void vhgwHorizontal(Mat inImg, int32_t height, int32_t width, int32_t kernelW, BorderType borderType,
+ *                     Vec3b borderValue, Mat outImg)
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
- * uint16_t filterCoeff : フィルタ係数
- * Mat outImg : 出力画像
+ * int32_t kernelW : 構造要素の横幅
+ * BorderType borderType : 画像の端の処理
+ * Vec3b borderValue : BorderType::Constantの画素値
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
- * 機能 : 平滑化フィルタ処理
+ * 機能 : van Herk/Gil-Werman法による横方向の最小値(最大値)フィルタ
+ *        kernelW画素ごとのブロック内で前方向と後方向の累積を求め、
+ *        窓の最小値(最大値)を2つの累積値の比較で求める
+ *        累積はx方向に1画素ずつしか進めないため、HGW_ROWS行を画素ごとに並べ替えて(転置して)まとめて走査し、
+ *        各画素の比較をminMaxRowで16画素値ずつ行う
  *
  * return : void
  *************************************************/
-void ImageProcessor::equalizationFilter(Mat inImg, int32_t height, int32_t width, int32_t filterCoeff, Mat outImg)
+template <bool IsMax>
+void vhgwHorizontal(Mat inImg, int32_t height, int32_t width, int32_t kernelW, BorderType borderType, Vec3b borderValue,
+                    Mat outImg)
 {
-    int32_t filterSize = (2 * filterCoeff + 1) * (2 * filterCoeff + 1);
-    int32_t redSum, greenSum, blueSum;
-
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            redSum = greenSum = blueSum = 0;
-
-            // fiterCoeff x filterCoeffのフィルタ処理
-            for (int32_t yy = -filterCoeff; yy <= filterCoeff; yy++) {
-                for (int32_t xx = -filterCoeff; xx <= filterCoeff; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx, 0, width - 1);
-
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
-
-                    // 画素値の総和
-                    redSum += pix[RED];
-                    greenSum += pix[GREEN];
-                    blueSum += pix[BLUE];
+    int32_t anchor = kernelW / 2;
+    int32_t padLen = (width + 2 * (kernelW - 1)) / kernelW * kernelW;  // width + kernelW - 1以上のブロック境界
+
+    // x番目の画素の行rの値は[x * stride + r * 3]に置く
+    size_t               bufLen = static_cast<size_t>(padLen) * HGW_ROWS * 3;
+    std::vector<uint8_t> pad(bufLen), g(bufLen), h(bufLen);
+
+    for (int32_t y0 = 0; y0 < height; y0 += HGW_ROWS) {
+        int32_t rows   = std::min(HGW_ROWS, height - y0);
+        int32_t stride = rows * 3;
+        auto    at     = [&](std::vector<uint8_t> &buf, int32_t i) { return &buf[static_cast<size_t>(i) * stride]; };
+
+        // 画像の端の処理 (内側はそのままコピー)
+        for (int32_t r = 0; r < rows; r++) {
+            const uint8_t *src     = inImg.ptr<uint8_t>(y0 + r);
+            auto           padEdge = [&](int32_t begin, int32_t end) {
+                for (int32_t i = begin; i < end; i++) {
+                    int32_t        srcX = borderIndex(i - anchor, width, borderType);
+                    const uint8_t *pix  = srcX >= 0 ? src + srcX * 3 : &borderValue[0];
+                    std::copy(pix, pix + 3, at(pad, i) + r * 3);
                 }
+            };
+            padEdge(0, anchor);
+            for (int32_t x = 0; x < width; x++) {
+                std::copy(src + x * 3, src + x * 3 + 3, at(pad, anchor + x) + r * 3);
             }
-            // 画素値の平均化
-            uint8_t red   = static_cast<uint8_t>(std::clamp(redSum / filterSize, 0, 255));
-            uint8_t green = static_cast<uint8_t>(std::clamp(greenSum / filterSize, 0, 255));
-            uint8_t blue  = static_cast<uint8_t>(std::clamp(blueSum / filterSize, 0, 255));
+            padEdge(anchor + width, padLen);
+        }
 
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
+        for (int32_t b0 = 0; b0 < padLen; b0 += kernelW) {
+            int32_t b1 = b0 + kernelW;
+
+            // ブロック内の前方向の累積
+            std::copy(at(pad, b0), at(pad, b0) + stride, at(g, b0));
+            for (int32_t i = b0 + 1; i < b1; i++) {
+                minMaxRow<IsMax>(at(g, i - 1), at(pad, i), at(g, i), stride);
+            }
+
+            // ブロック内の後方向の累積
+            std::copy(at(pad, b1 - 1), at(pad, b1 - 1) + stride, at(h, b1 - 1));
+            for (int32_t i = b1 - 2; i >= b0; i--) {
+                minMaxRow<IsMax>(at(h, i + 1), at(pad, i), at(h, i), stride);
+            }
+        }
+
+        // 窓[x, x + kernelW - 1]は後方向の累積h[x]と前方向の累積g[x + kernelW - 1]で覆われる (結果はpadに書く)
+        minMaxRow<IsMax>(at(h, 0), at(g, kernelW - 1), at(pad, 0), width * stride);
+        for (int32_t r = 0; r < rows; r++) {
+            uint8_t *dst = outImg.ptr<uint8_t>(y0 + r);
+            for (int32_t x = 0; x < width; x++) {
+                std::copy(at(pad, x) + r * 3, at(pad, x) + r * 3 + 3, dst + x * 3);
+            }
         }
     }
 }
 
 /*************************************************
- * void weightedAverageFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * void vhgwVertical(Mat inImg, int32_t height, int32_t width, int32_t kernelH, BorderType borderType,
+ *                   Vec3b borderValue, Mat outImg)
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
- * Mat outImg : 出力画像
+ * int32_t kernelH : 構造要素の高さ
+ * BorderType borderType : 画像の端の処理
+ * Vec3b borderValue : BorderType::Constantの画素値
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
- * 機能 : 加重平均フィルタ処理
+ * 機能 : van Herk/Gil-Werman法による縦方向の最小値(最大値)フィルタ
+ *        行単位で累積を求めるため、比較はすべてminMaxRowでまとめて行う
+ *        累積は直前と現在のブロック分だけ保持し、求まった行から順に出力する
  *
  * return : void
  *************************************************/
-void ImageProcessor::weightedAverageFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+template <bool IsMax>
+void vhgwVertical(Mat inImg, int32_t height, int32_t width, int32_t kernelH, BorderType borderType, Vec3b borderValue,
+                  Mat outImg)
 {
-    int32_t filter[3][3] = {
-        {1, 2, 1},
-        {2, 8, 2},
-        {1, 2, 1}
-    };  // 加重平均フィルタ
-    int32_t filterSum = std::reduce(&filter[0][0], &filter[0][0] + 3 * 3);
-    int32_t redSum, greenSum, blueSum;
+    int32_t anchor   = kernelH / 2;
+    int32_t padLen   = (height + 2 * (kernelH - 1)) / kernelH * kernelH;
+    int32_t rowBytes = width * 3;
+    int32_t ringLen  = 2 * kernelH;  // 直前と現在のブロックの累積
 
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            redSum = greenSum = blueSum = 0;
+    BorderRows           border(inImg, height, width, borderType, borderValue, inImg.data == outImg.data, 3 * kernelH);
+    std::vector<uint8_t> g(static_cast<size_t>(ringLen) * rowBytes), h(static_cast<size_t>(ringLen) * rowBytes);
 
-            // 3x3のフィルタ処理(-1から1までの範囲)
-            for (int32_t yy = -1; yy <= 1; yy++) {
-                for (int32_t xx = -1; xx <= 1; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx, 0, width - 1);
+    auto gRow = [&](int32_t i) { return &g[static_cast<size_t>(i % ringLen) * rowBytes]; };
+    auto hRow = [&](int32_t i) { return &h[static_cast<size_t>(i % ringLen) * rowBytes]; };
 
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
+    int32_t next = 0;  // 次に出力する行
+    for (int32_t b0 = 0; b0 < padLen; b0 += kernelH) {
+        int32_t b1 = b0 + kernelH;
 
-                    // 画素値とフィルタの積和
-                    redSum += filter[yy + 1][xx + 1] * pix[RED];
-                    greenSum += filter[yy + 1][xx + 1] * pix[GREEN];
-                    blueSum += filter[yy + 1][xx + 1] * pix[BLUE];
-                }
-            }
-            // 画素値の正規化、0~255に収める
-            uint8_t red   = static_cast<uint8_t>(std::clamp(redSum / filterSum, 0, 255));
-            uint8_t green = static_cast<uint8_t>(std::clamp(greenSum / filterSum, 0, 255));
-            uint8_t blue  = static_cast<uint8_t>(std::clamp(blueSum / filterSum, 0, 255));
+        // ブロック内の前方向の累積
+        std::copy(border.row(b0 - anchor), border.row(b0 - anchor) + rowBytes, gRow(b0));
+        for (int32_t i = b0 + 1; i < b1; i++) {
+            minMaxRow<IsMax>(gRow(i - 1), border.row(i - anchor), gRow(i), rowBytes);
+        }
 
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
+        // ブロック内の後方向の累積
+        std::copy(border.row(b1 - 1 - anchor), border.row(b1 - 1 - anchor) + rowBytes, hRow(b1 - 1));
+        for (int32_t i = b1 - 2; i >= b0; i--) {
+            minMaxRow<IsMax>(hRow(i + 1), border.row(i - anchor), hRow(i), rowBytes);
+        }
+
+        // 前方向の累積g[y + kernelH - 1]が求まった行を出力
+        for (; next < height && next <= b0; next++) {
+            border.retire(next);
+            minMaxRow<IsMax>(hRow(next), gRow(next + kernelH - 1), outImg.ptr<uint8_t>(next), rowBytes);
         }
     }
 }
 
 /*************************************************
- * void sharpeningFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * void vhgwFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, BorderType borderType,
+ *                 Vec3b borderValue, Mat outImg)
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
- * Mat outImg : 出力画像
+ * int32_t kernelW : 構造要素の横幅
+ * int32_t kernelH : 構造要素の高さ
+ * BorderType borderType : 画像の端の処理
+ * Vec3b borderValue : BorderType::Constantの画素値
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
- * 機能 : 先鋭化フィルタ処理
+ * 機能 : 矩形の構造要素による収縮(IsMax=false)または膨張(IsMax=true)
+ *        矩形は横と縦に分離できるため、横方向と縦方向の順に処理する
+ *        横方向の結果は出力画像に書き、縦方向はその出力画像をインプレースで処理する
  *
  * return : void
  *************************************************/
-void ImageProcessor::sharpeningFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+template <bool IsMax>
+void vhgwFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, BorderType borderType,
+                Vec3b borderValue, Mat outImg)
 {
-    int32_t filter[3][3] = {
-        {0,  -1, 0 },
-        {-1, 5,  -1},
-        {0,  -1, 0 }
-    };  // 先鋭化フィルタ(4近傍)
-    int32_t redSum, greenSum, blueSum;
+    vhgwHorizontal<IsMax>(inImg, height, width, std::max(kernelW, 1), borderType, borderValue, outImg);
+    vhgwVertical<IsMax>(outImg, height, width, std::max(kernelH, 1), borderType, borderValue, outImg);
+}
+}  // namespace
 
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            redSum = greenSum = blueSum = 0;
+/*************************************************
+ * void setBorder(BorderType borderType, Vec3b borderValue)
+ * BorderType borderType : 画像の端の処理 (デフォルト: リピート)
+ * Vec3b borderValue : BorderType::Constantの画素値
+ *
+ * 機能 : 近傍を参照するフィルタの画像の端の処理を設定
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::setBorder(BorderType borderType, Vec3b borderValue)
+{
+    borderType_  = borderType;
+    borderValue_ = borderValue;
+}
 
-            // 3x3のフィルタ処理(-1から1までの範囲)
-            for (int32_t yy = -1; yy <= 1; yy++) {
-                for (int32_t xx = -1; xx <= 1; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx, 0, width - 1);
+/*************************************************
+ * SizeClass sizeClassOf(int32_t height, int32_t width)
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ *
+ * 機能 : 画素数から画像の大きさの区分を求める
+ *
+ * return : SizeClass 画像の大きさの区分
+ *************************************************/
+SizeClass sizeClassOf(int32_t height, int32_t width)
+{
+    int64_t pixels = static_cast<int64_t>(height) * width;
+    return pixels < (1 << 20) ? SizeClass::Small : pixels < (4 << 20) ? SizeClass::Medium : SizeClass::Large;
+}
 
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
+/*************************************************
+ * void setTuning(IpsType ipsType, SizeClass sizeClass, TuneConfig config)
+ * IpsType ipsType : 処理
+ * SizeClass sizeClass : 画像の大きさの区分
+ * TuneConfig config : スレッド数、帯の行数、実装
+ *
+ * 機能 : 処理の実行時の設定を指定 (EqualizationFilter、MedianFilter、勾配フィルタ、Convolutionが対象)
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::setTuning(IpsType ipsType, SizeClass sizeClass, TuneConfig config)
+{
+    config.threadNum               = std::max(config.threadNum, 1);
+    config.tileRows                = std::max(config.tileRows, 0);
+    tunings_[{ipsType, sizeClass}] = config;
+}
 
-                    // 画素値とフィルタの積和
-                    redSum += filter[yy + 1][xx + 1] * pix[RED];
-                    greenSum += filter[yy + 1][xx + 1] * pix[GREEN];
-                    blueSum += filter[yy + 1][xx + 1] * pix[BLUE];
-                }
-            }
-            // 画像の輝度値を0~255に収める
-            uint8_t red   = static_cast<uint8_t>(std::clamp(redSum, 0, 255));
-            uint8_t green = static_cast<uint8_t>(std::clamp(greenSum, 0, 255));
-            uint8_t blue  = static_cast<uint8_t>(std::clamp(blueSum, 0, 255));
+/*************************************************
+ * TuneConfig tuning(IpsType ipsType, int32_t height, int32_t width) const
+ * IpsType ipsType : 処理
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ *
+ * 機能 : 画像の大きさに対応する処理の実行時の設定を取得
+ *
+ * return : TuneConfig 設定 (指定されていない場合は既定値)
+ *************************************************/
+TuneConfig ImageProcessor::tuning(IpsType ipsType, int32_t height, int32_t width) const
+{
+    auto it = tunings_.find({ipsType, sizeClassOf(height, width)});
+    return it != tunings_.end() ? it->second : TuneConfig{};
+}
 
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
-        }
+/*************************************************
+ * void equalizationFilter(Mat inImg, int32_t height, int32_t width, uint16_t filterCoeff, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * uint16_t filterCoeff : フィルタ係数
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 平滑化フィルタ処理
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::equalizationFilter(Mat inImg, int32_t height, int32_t width, int32_t filterCoeff, Mat outImg)
+{
+    int32_t    filterSize = (2 * filterCoeff + 1) * (2 * filterCoeff + 1);
+    TuneConfig config     = tuning(IpsType::EqualizationFilter, height, width);
+
+    // 積分画像による実装 (半径が一定のboxFilterと同じ結果、半径は画素値で指定するため255まで)
+    if (config.variant == Variant::Integral && filterCoeff <= 255) {
+        boxFilterTuned(inImg, height, width, Mat{height, width, CV_8UC1, Scalar(filterCoeff)}, config, outImg);
+        return;
     }
+
+    // (2 * filterCoeff + 1) x (2 * filterCoeff + 1)の平均化フィルタ (分離可能)
+    Mat filter = Mat{2 * filterCoeff + 1, 2 * filterCoeff + 1, CV_32SC1, Scalar(1)};
+
+    // 画素値の平均化
+    convolveTuned(inImg, height, width, filter, filterSize, 0, config, outImg);
+}
+
+/*************************************************
+ * void weightedAverageFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 加重平均フィルタ処理
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::weightedAverageFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+{
+    const auto &filter    = WEIGHTED_AVERAGE_KERNEL;
+    int32_t     filterSum = std::reduce(&filter[0][0], &filter[0][0] + 3 * 3);
+
+    // 画素値とフィルタの積和を正規化
+    convolve(inImg, height, width, kernelMat(filter), filterSum, 0, outImg);
+}
+
+/*************************************************
+ * void sharpeningFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 先鋭化フィルタ処理
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::sharpeningFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+{
+    // 画素値とフィルタの積和
+    convolve(inImg, height, width, kernelMat(SHARPENING_KERNEL), 1, 0, outImg);
 }
 
 /*************************************************
@@ -162,7 +434,7 @@ void ImageProcessor::sharpeningFilter(Mat inImg, int32_t height, int32_t width,
  * Mat inImg : 入力画像
  * int height : 高さ
  * int width : 横幅
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : エッジ検出フィルタ処理
  *
@@ -170,60 +442,9 @@ void ImageProcessor::sharpeningFilter(Mat inImg, int32_t height, int32_t width,
  *************************************************/
 void ImageProcessor::edgeDetectionFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
 {
-    int32_t filter1[3][3] = {
-        {0, 0, 0 },
-        {1, 0, -1},
-        {0, 0, 0 }
-    };  // 横フィルタ
-    int32_t filter2[3][3] = {
-        {0, 1,  0},
-        {0, 0,  0},
-        {0, -1, 0}
-    };  // 縦フィルタ
-    int32_t rrx, ggx, bbx;
-    int32_t rry, ggy, bby;
-
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            rrx = ggx = bbx = 0;
-            rry = ggy = bby = 0;
-
-            // 3x3のフィルタ処理
-            for (int32_t yy = 0; yy < FILTER_SIZE; yy++) {
-                for (int32_t xx = 0; xx < FILTER_SIZE; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy - 1, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx - 1, 0, width - 1);
-
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
-
-                    // 画素値と横フィルタの積和
-                    rrx += pix[RED] * filter1[yy][xx];
-                    ggx += pix[GREEN] * filter1[yy][xx];
-                    bbx += pix[BLUE] * filter1[yy][xx];
-
-                    // 画素値と縦フィルタの積和
-                    rry += pix[RED] * filter2[yy][xx];
-                    ggy += pix[GREEN] * filter2[yy][xx];
-                    bby += pix[BLUE] * filter2[yy][xx];
-                }
-            }
-
-            // 画素値の平方根
-            double red   = sqrt(static_cast<double>(rrx * rrx + rry * rry));
-            double green = sqrt(static_cast<double>(ggx * ggx + ggy * ggy));
-            double blue  = sqrt(static_cast<double>(bbx * bbx + bby * bby));
-
-            // 画像の輝度値を0~255に収める
-            uint8_t red8   = static_cast<uint8_t>(std::clamp(red, 0., 255.));
-            uint8_t green8 = static_cast<uint8_t>(std::clamp(green, 0., 255.));
-            uint8_t blue8  = static_cast<uint8_t>(std::clamp(blue, 0., 255.));
-
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue8, green8, red8);
-        }
-    }
+    // 横方向と縦方向の積和から勾配の大きさを求める
+    gradientFilter(inImg, height, width, kernelMat(EDGE_DETECTION_KERNEL_X), kernelMat(EDGE_DETECTION_KERNEL_Y),
+                   tuning(IpsType::EdgeDetectionFilter, height, width), outImg);
 }
 
 /*************************************************
@@ -231,7 +452,7 @@ void ImageProcessor::edgeDetectionFilter(Mat inImg, int32_t height, int32_t widt
  * Mat inImg : 入力画像
  * int height : 高さ
  * int width : 横幅
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : Sobelフィルタを用いてエッジを抽出する
  *
@@ -239,60 +460,9 @@ void ImageProcessor::edgeDetectionFilter(Mat inImg, int32_t height, int32_t widt
  *************************************************/
 void ImageProcessor::sobelFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
 {
-    int32_t filter1[3][3] = {
-        {1,  2,  1 },
-        {0,  0,  0 },
-        {-1, -2, -1}
-    };  // 横方向のSobelフィルタ
-    int32_t filter2[3][3] = {
-        {1, 0, -1},
-        {2, 0, -2},
-        {1, 0, -1}
-    };  // 縦方向のSobelフィルタ
-    int32_t rrx, ggx, bbx;
-    int32_t rry, ggy, bby;
-
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            rrx = ggx = bbx = 0;
-            rry = ggy = bby = 0;
-
-            // 3x3のフィルタ処理
-            for (int32_t yy = 0; yy < FILTER_SIZE; yy++) {
-                for (int32_t xx = 0; xx < FILTER_SIZE; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy - 1, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx - 1, 0, width - 1);
-
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
-
-                    // 画素値と横フィルタの積和
-                    rrx += pix[RED] * filter1[yy][xx];
-                    ggx += pix[GREEN] * filter1[yy][xx];
-                    bbx += pix[BLUE] * filter1[yy][xx];
-
-                    // 画素値と縦フィルタの積和
-                    rry += pix[RED] * filter2[yy][xx];
-                    ggy += pix[GREEN] * filter2[yy][xx];
-                    bby += pix[BLUE] * filter2[yy][xx];
-                }
-            }
-
-            // 画素値の平方根
-            double red   = sqrt(static_cast<double>(rrx * rrx + rry * rry));
-            double green = sqrt(static_cast<double>(ggx * ggx + ggy * ggy));
-            double blue  = sqrt(static_cast<double>(bbx * bbx + bby * bby));
-
-            // 画像の輝度値を0~255に収める
-            uint8_t red8   = static_cast<uint8_t>(std::clamp(red, 0., 255.));
-            uint8_t green8 = static_cast<uint8_t>(std::clamp(green, 0., 255.));
-            uint8_t blue8  = static_cast<uint8_t>(std::clamp(blue, 0., 255.));
-
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue8, green8, red8);
-        }
-    }
+    // 横方向と縦方向の積和から勾配の大きさを求める
+    gradientFilter(inImg, height, width, kernelMat(SOBEL_KERNEL_X), kernelMat(SOBEL_KERNEL_Y),
+                   tuning(IpsType::SobelFilter, height, width), outImg);
 }
 
 /*************************************************
@@ -300,7 +470,7 @@ void ImageProcessor::sobelFilter(Mat inImg, int32_t height, int32_t width, Mat o
  * Mat inImg : 入力画像
  * int height : 高さ
  * int width : 横幅
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : Prewittフィルタを用いてエッジを抽出する
  *
@@ -308,227 +478,527 @@ void ImageProcessor::sobelFilter(Mat inImg, int32_t height, int32_t width, Mat o
  *************************************************/
 void ImageProcessor::prewittFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
 {
-    int32_t filter1[3][3] = {
-        {1,  1,  1 },
-        {0,  0,  0 },
-        {-1, -1, -1}
-    };  // 横方向のPrewittフィルタ
-    int32_t filter2[3][3] = {
-        {1, 0, -1},
-        {1, 0, -1},
-        {1, 0, -1}
-    };  // 縦方向のPrewittフィルタ
-    int32_t rrx, ggx, bbx;
-    int32_t rry, ggy, bby;
+    // 横方向と縦方向の積和から勾配の大きさを求める
+    gradientFilter(inImg, height, width, kernelMat(PREWITT_KERNEL_X), kernelMat(PREWITT_KERNEL_Y),
+                   tuning(IpsType::PrewittFilter, height, width), outImg);
+}
 
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            rrx = ggx = bbx = 0;
-            rry = ggy = bby = 0;
-
-            // 3x3のフィルタ処理
-            for (int32_t yy = 0; yy < FILTER_SIZE; yy++) {
-                for (int32_t xx = 0; xx < FILTER_SIZE; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy - 1, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx - 1, 0, width - 1);
-
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
-
-                    // 画素値と横フィルタの積和
-                    rrx += pix[RED] * filter1[yy][xx];
-                    ggx += pix[GREEN] * filter1[yy][xx];
-                    bbx += pix[BLUE] * filter1[yy][xx];
-
-                    // 画素値と縦フィルタの積和
-                    rry += pix[RED] * filter2[yy][xx];
-                    ggy += pix[GREEN] * filter2[yy][xx];
-                    bby += pix[BLUE] * filter2[yy][xx];
+/*************************************************
+ * void robertsFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * Mat inImg : 入力画像
+ * int height : 高さ
+ * int width : 横幅
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : Robertsフィルタを用いてエッジを抽出する
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::robertsFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+{
+    // 横方向と縦方向の積和から勾配の大きさを求める
+    gradientFilter(inImg, height, width, kernelMat(ROBERTS_KERNEL_X), kernelMat(ROBERTS_KERNEL_Y),
+                   tuning(IpsType::RobertsFilter, height, width), outImg);
+}
+
+/*************************************************
+ * void embossingFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : エンボスフィルタ処理
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::embossingFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+{
+    // 画像の輝度値を0~255に収める
+    convolve(inImg, height, width, kernelMat(EMBOSSING_KERNEL), EMBOSSING_DIVISOR, EMBOSSING_BIAS, outImg);
+}
+
+/*************************************************
+ * void medianFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : メディアンフィルタ処理
+ *        Variant::Simdでは内側の画素を選択ネットワークで16画素値ずつ求める
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::medianFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+{
+    int32_t    filterSize = 3;
+    bool       inPlace    = inImg.data == outImg.data;
+    TuneConfig config     = tuning(IpsType::MedianFilter, height, width);
+
+    forEachStrip(height, config.tileRows, inPlace ? 1 : config.threadNum, [&](int32_t y0, int32_t y1) {
+        int32_t    red[9], green[9], blue[9];
+        BorderRows border(inImg, height, width, borderType_, borderValue_, inPlace, filterSize);
+
+        // 3x3の画素値の中央値を書き込む
+        auto writeMedian = [&](int32_t y, int32_t x, const uint8_t *const pixels[9]) {
+            for (int32_t idx = 0; idx < filterSize * filterSize; idx++) {
+                red[idx]   = pixels[idx][RED];
+                green[idx] = pixels[idx][GREEN];
+                blue[idx]  = pixels[idx][BLUE];
+            }
+
+            // 画素値のソート
+            std::sort(red, red + filterSize * filterSize);
+            std::sort(green, green + filterSize * filterSize);
+            std::sort(blue, blue + filterSize * filterSize);
+
+            // 画素の書き込み
+            outImg.at<Vec3b>(y, x) = Vec3b(blue[4], green[4], red[4]);
+        };
+
+        // 画像の端の処理 (上下左右の1画素のみ)
+        auto edgePixel = [&](int32_t y, int32_t x) {
+            const uint8_t *pixels[9];
+            int32_t        idx = 0;
+            for (int32_t yy = -1; yy <= 1; yy++) {
+                for (int32_t xx = -1; xx <= 1; xx++) {
+                    int32_t srcX  = borderIndex(x + xx, width, borderType_);
+                    pixels[idx++] = srcX >= 0 ? border.row(y + yy) + srcX * 3 : &borderValue_[0];
                 }
             }
+            writeMedian(y, x, pixels);
+        };
 
-            // 画素値の平方根
-            double red   = sqrt(static_cast<double>(rrx * rrx + rry * rry));
-            double green = sqrt(static_cast<double>(ggx * ggx + ggy * ggy));
-            double blue  = sqrt(static_cast<double>(bbx * bbx + bby * bby));
+        for (int32_t y = y0; y < y1; y++) {
+            // 書き込む前に元の行を保存 (インプレース処理の場合)
+            border.retire(y);
 
-            // 画像の輝度値を0~255に収める
-            uint8_t red8   = static_cast<uint8_t>(std::clamp(red, 0., 255.));
-            uint8_t green8 = static_cast<uint8_t>(std::clamp(green, 0., 255.));
-            uint8_t blue8  = static_cast<uint8_t>(std::clamp(blue, 0., 255.));
+            if (y == 0 || y == height - 1) {
+                for (int32_t x = 0; x < width; x++) {
+                    edgePixel(y, x);
+                }
+                continue;
+            }
 
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue8, green8, red8);
+            edgePixel(y, 0);
+
+            // 内側 (端の処理なし)
+            const uint8_t *rows[3] = {border.row(y - 1), border.row(y), border.row(y + 1)};
+            int32_t        x       = 1;
+#ifdef __SSE2__
+            if (config.variant == Variant::Simd) {
+                x = median3x3Simd(rows, width, outImg.ptr<uint8_t>(y));
+            }
+#endif
+            for (; x < width - 1; x++) {
+                const uint8_t *pixels[9];
+                for (int32_t yy = 0; yy < 3; yy++) {
+                    pixels[yy * 3]     = rows[yy] + (x - 1) * 3;
+                    pixels[yy * 3 + 1] = rows[yy] + x * 3;
+                    pixels[yy * 3 + 2] = rows[yy] + (x + 1) * 3;
+                }
+                writeMedian(y, x, pixels);
+            }
+
+            if (width > 1) {
+                edgePixel(y, width - 1);
+            }
         }
-    }
+    });
 }
 
 /*************************************************
- * void robertsFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * void bilateralFilter(Mat inImg, int32_t height, int32_t width, double sigmaSpace, double sigmaRange, Mat outImg)
  * Mat inImg : 入力画像
- * int height : 高さ
- * int width : 横幅
- * Mat outImg : 出力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * double sigmaSpace : 空間方向のσ (画素、正の有限の値)
+ * double sigmaRange : 輝度方向のσ (画素値、正の有限の値)
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
- * 機能 : Robertsフィルタを用いてエッジを抽出する
+ * 機能 : バイラテラルグリッドを用いたバイラテラルフィルタ処理
+ *        画素を間引いたグリッドに投票(splat)し、グリッドをぼかして(blur)、
+ *        三線形補間で読み出す(slice)ため、処理量は空間方向のσに依存しない
+ *        画像の端の処理は画像の外側のセルに対してグリッド上で行う
+ *        輝度方向の分割数はMAX_RANGE_BINSまでとし、σrが小さい場合はその分割数になるσrで処理する
+ *        空間方向のσがMIN_GRID_SIGMA_SPACEより小さい場合 (グリッドが間引きにならない場合) は
+ *        窓内の画素を直接重み付けする (窓の大きさはMIN_GRID_SIGMA_SPACEで抑えられる)
+ *        σが正の有限の値でない場合は入力画像をそのまま出力する
  *
  * return : void
  *************************************************/
-void ImageProcessor::robertsFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+void ImageProcessor::bilateralFilter(Mat inImg, int32_t height, int32_t width, double sigmaSpace, double sigmaRange,
+                                     Mat outImg)
 {
-    int32_t filter1[3][3] = {
-        {0, 0, 0 },
-        {0, 1, 0 },
-        {0, 0, -1}
-    };  // 横方向のRobertsフィルタ
-    int32_t filter2[3][3] = {
-        {0, 0,  0},
-        {0, 0,  1},
-        {0, -1, 0}
-    };  // 縦方向のRobertsフィルタ
-    int32_t rrx, ggx, bbx;
-    int32_t rry, ggy, bby;
+    if (!(std::isfinite(sigmaSpace) && sigmaSpace > 0.0 && std::isfinite(sigmaRange) && sigmaRange > 0.0)) {
+        Mat outRoi = outImg(Rect(0, 0, width, height));
+        inImg(Rect(0, 0, width, height)).copyTo(outRoi);
+        return;
+    }
 
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            rrx = ggx = bbx = 0;
-            rry = ggy = bby = 0;
-
-            // 3x3のフィルタ処理
-            for (int32_t yy = 0; yy < FILTER_SIZE; yy++) {
-                for (int32_t xx = 0; xx < FILTER_SIZE; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy - 1, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx - 1, 0, width - 1);
-
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
-
-                    // 画素値と横フィルタの積和
-                    rrx += pix[RED] * filter1[yy][xx];
-                    ggx += pix[GREEN] * filter1[yy][xx];
-                    bbx += pix[BLUE] * filter1[yy][xx];
-
-                    // 画素値と縦フィルタの積和
-                    rry += pix[RED] * filter2[yy][xx];
-                    ggy += pix[GREEN] * filter2[yy][xx];
-                    bby += pix[BLUE] * filter2[yy][xx];
-                }
+    if (sigmaSpace < MIN_GRID_SIGMA_SPACE) {
+        bilateralDirect(inImg, height, width, sigmaSpace, sigmaRange,
+                        static_cast<int32_t>(std::ceil(2 * sigmaSpace)), outImg);
+        return;
+    }
+    sigmaRange = std::max(sigmaRange, 255.0 / MAX_RANGE_BINS);
+
+    // グリッドサイズ (画像は1~lastY, 1~lastXのセルに投票し、その外側の1~2セルで端の処理とぼかしの余白を持たせる)
+    int32_t lastY = static_cast<int32_t>((height - 1) / sigmaSpace + 1.5);
+    int32_t lastX = static_cast<int32_t>((width - 1) / sigmaSpace + 1.5);
+    int32_t gridH = static_cast<int32_t>((height - 1) / sigmaSpace) + 4;
+    int32_t gridW = static_cast<int32_t>((width - 1) / sigmaSpace) + 4;
+    int32_t gridD = static_cast<int32_t>(255 / sigmaRange) + 4;
+    size_t  cells = static_cast<size_t>(gridH) * gridW * gridD;
+
+    // Constantの外側のセルの重み (1セルに入る画素数)
+    float cellWeight = static_cast<float>(sigmaSpace * sigmaSpace);
+
+    // チャンネルごとに処理する (各チャンネルは自身の画素値のみを参照するため、インプレース処理でもよい)
+    for (int32_t c = 0; c < 3; c++) {
+        grid_.assign(cells * 2, 0.f);
+
+        // splat : 各画素を最も近いグリッドに投票
+        for (int32_t y = 0; y < height; y++) {
+            int32_t        gy  = static_cast<int32_t>(y / sigmaSpace + 1.5);
+            const uint8_t *src = inImg.ptr<uint8_t>(y) + c;
+            for (int32_t x = 0; x < width; x++) {
+                int32_t gx  = static_cast<int32_t>(x / sigmaSpace + 1.5);
+                uint8_t val = src[x * 3];
+                int32_t gz  = static_cast<int32_t>(val / sigmaRange + 1.5);
+                size_t  idx = ((static_cast<size_t>(gy) * gridW + gx) * gridD + gz) * 2;
+
+                grid_[idx] += val;
+                grid_[idx + 1] += 1.f;
             }
+        }
 
-            // 画素値の平方根
-            double red   = sqrt(static_cast<double>(rrx * rrx + rry * rry));
-            double green = sqrt(static_cast<double>(ggx * ggx + ggy * ggy));
-            double blue  = sqrt(static_cast<double>(bbx * bbx + bby * bby));
+        // 画像の端の処理 : 外側のセルに、端の処理に従って対応する内側のセルを写す (Constantは定数の画素値を投票)
+        for (int32_t gy = 0; gy < gridH; gy++) {
+            int32_t srcY = borderIndex(gy - 1, lastY, borderType_);
+            for (int32_t gx = 0; gx < gridW; gx++) {
+                if (gy >= 1 && gy <= lastY && gx >= 1 && gx <= lastX) {
+                    continue;
+                }
+                int32_t srcX = borderIndex(gx - 1, lastX, borderType_);
+                float  *dst  = &grid_[(static_cast<size_t>(gy) * gridW + gx) * gridD * 2];
+                if (srcY < 0 || srcX < 0) {
+                    int32_t gz = static_cast<int32_t>(borderValue_[c] / sigmaRange + 1.5);
+                    dst[gz * 2]     = borderValue_[c] * cellWeight;
+                    dst[gz * 2 + 1] = cellWeight;
+                } else {
+                    const float *src = &grid_[(static_cast<size_t>(srcY + 1) * gridW + srcX + 1) * gridD * 2];
+                    std::copy(src, src + gridD * 2, dst);
+                }
+            }
+        }
 
-            // 画像の輝度値を0~255に収める
-            uint8_t red8   = static_cast<uint8_t>(std::clamp(red, 0., 255.));
-            uint8_t green8 = static_cast<uint8_t>(std::clamp(green, 0., 255.));
-            uint8_t blue8  = static_cast<uint8_t>(std::clamp(blue, 0., 255.));
+        // blur : グリッドをぼかす
+        blurGrid(grid_, gridTmp_, gridH, gridW, gridD);
+
+        // slice : グリッドを三線形補間して画素値を求める
+        for (int32_t y = 0; y < height; y++) {
+            double  fy = y / sigmaSpace + 1;
+            int32_t y0 = static_cast<int32_t>(fy);
+            float   wy = static_cast<float>(fy - y0);
+
+            for (int32_t x = 0; x < width; x++) {
+                double  fx = x / sigmaSpace + 1;
+                int32_t x0 = static_cast<int32_t>(fx);
+                float   wx = static_cast<float>(fx - x0);
+
+                // 画素値取得
+                uint8_t val = inImg.at<Vec3b>(y, x)[c];
+                double  fz  = val / sigmaRange + 1;
+                int32_t z0  = static_cast<int32_t>(fz);
+                float   wz  = static_cast<float>(fz - z0);
+
+                float valSum = 0.f;
+                float wtSum  = 0.f;
+
+                // 周囲8セルの重み付き和
+                for (int32_t dy = 0; dy <= 1; dy++) {
+                    for (int32_t dx = 0; dx <= 1; dx++) {
+                        for (int32_t dz = 0; dz <= 1; dz++) {
+                            float  w   = (dy ? wy : 1.f - wy) * (dx ? wx : 1.f - wx) * (dz ? wz : 1.f - wz);
+                            size_t idx = ((static_cast<size_t>(y0 + dy) * gridW + x0 + dx) * gridD + z0 + dz) * 2;
+
+                            valSum += w * grid_[idx];
+                            wtSum += w * grid_[idx + 1];
+                        }
+                    }
+                }
 
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue8, green8, red8);
+                // 重みで正規化して0~255に収め、画素に書き込む
+                outImg.at<Vec3b>(y, x)[c] =
+                    wtSum > 0.f ? static_cast<uint8_t>(std::clamp(valSum / wtSum + 0.5f, 0.f, 255.f)) : val;
+            }
         }
     }
 }
 
 /*************************************************
- * void embossingFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * void bilateralDirect(Mat inImg, int32_t height, int32_t width, double sigmaSpace, double sigmaRange,
+ *                      int32_t radius, Mat outImg)
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
- * Mat outImg : 出力画像
+ * double sigmaSpace : 空間方向のσ (画素)
+ * double sigmaRange : 輝度方向のσ (画素値)
+ * int32_t radius : 窓の半径
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
- * 機能 : エンボスフィルタ処理
+ * 機能 : 窓内の画素を空間方向と輝度方向のガウス重みで直接平均するバイラテラルフィルタ処理
+ *        (σが小さい場合に、グリッドの代わりに使う)
  *
  * return : void
  *************************************************/
-void ImageProcessor::embossingFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+void ImageProcessor::bilateralDirect(Mat inImg, int32_t height, int32_t width, double sigmaSpace, double sigmaRange,
+                                     int32_t radius, Mat outImg)
 {
-    int32_t filter[3][3] = {
-        {0,  0, 0},
-        {-3, 0, 3},
-        {0,  0, 0}
-    };  // エンボスフィルタ (数値を大きくするとエンボスの強さが増す)
-    int32_t redSum, greenSum, blueSum;
-
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            redSum = greenSum = blueSum = 0;
+    int32_t    winSize = 2 * radius + 1;
+    bool       inPlace = inImg.data == outImg.data;
+    TuneConfig config  = tuning(IpsType::BilateralFilter, height, width);
+
+    // 空間方向と輝度方向の重み
+    std::vector<float> spaceWeight(static_cast<size_t>(winSize) * winSize);
+    for (int32_t dy = -radius; dy <= radius; dy++) {
+        for (int32_t dx = -radius; dx <= radius; dx++) {
+            spaceWeight[(dy + radius) * winSize + dx + radius] =
+                static_cast<float>(std::exp(-(dx * dx + dy * dy) / (2 * sigmaSpace * sigmaSpace)));
+        }
+    }
+    float rangeWeight[256];
+    for (int32_t d = 0; d < 256; d++) {
+        rangeWeight[d] = static_cast<float>(std::exp(-(d * d) / (2 * sigmaRange * sigmaRange)));
+    }
 
-            // 3x3のフィルタ処理(-1から1までの範囲)
-            for (int32_t yy = -1; yy <= 1; yy++) {
-                for (int32_t xx = -1; xx <= 1; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx, 0, width - 1);
+    // 画像の端の処理をした列オフセット表 (Constantの範囲外は-1)
+    std::vector<int32_t> xTab(width + 2 * radius);
+    for (int32_t px = 0; px < width + 2 * radius; px++) {
+        int32_t srcX = borderIndex(px - radius, width, borderType_);
+        xTab[px]     = srcX >= 0 ? srcX * 3 : -1;
+    }
 
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
+    forEachStrip(height, config.tileRows, inPlace ? 1 : config.threadNum, [&](int32_t y0, int32_t y1) {
+        BorderRows           border(inImg, height, width, borderType_, borderValue_, inPlace, winSize);
+        std::vector<uint8_t> outRow(width * 3);
+
+        for (int32_t y = y0; y < y1; y++) {
+            for (int32_t x = 0; x < width; x++) {
+                const uint8_t *center = border.row(y) + x * 3;
+
+                float valSum[3] = {0.f, 0.f, 0.f};
+                float wtSum[3]  = {0.f, 0.f, 0.f};
+                for (int32_t dy = -radius; dy <= radius; dy++) {
+                    const uint8_t *src     = border.row(y + dy);
+                    const float   *spaceWt = &spaceWeight[(dy + radius) * winSize];
+                    for (int32_t dx = 0; dx < winSize; dx++) {
+                        int32_t        offset = xTab[x + dx];
+                        const uint8_t *pix    = offset >= 0 ? src + offset : &borderValue_[0];
+                        for (int32_t c = 0; c < 3; c++) {
+                            float w = spaceWt[dx] * rangeWeight[std::abs(pix[c] - center[c])];
+                            valSum[c] += w * pix[c];
+                            wtSum[c] += w;
+                        }
+                    }
+                }
 
-                    // 画素値とフィルタの積和
-                    redSum += filter[yy + 1][xx + 1] * pix[RED];
-                    greenSum += filter[yy + 1][xx + 1] * pix[GREEN];
-                    blueSum += filter[yy + 1][xx + 1] * pix[BLUE];
+                for (int32_t c = 0; c < 3; c++) {
+                    outRow[x * 3 + c] = static_cast<uint8_t>(std::clamp(valSum[c] / wtSum[c] + 0.5f, 0.f, 255.f));
                 }
             }
-            // 画像の輝度値を0~255に収める
-            // 128は中間の明るさを示し、6はフィルタの係数の絶対値、それで割ることで画像のコントラストを調整
-            uint8_t red   = static_cast<uint8_t>(std::clamp(redSum / 6 + 128, 0, 255));
-            uint8_t green = static_cast<uint8_t>(std::clamp(greenSum / 6 + 128, 0, 255));
-            uint8_t blue  = static_cast<uint8_t>(std::clamp(blueSum / 6 + 128, 0, 255));
 
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
+            // 書き込む前に元の行を保存 (インプレース処理の場合)
+            border.retire(y);
+            std::copy(outRow.begin(), outRow.end(), outImg.ptr<uint8_t>(y));
         }
-    }
+    });
 }
 
 /*************************************************
- * void medianFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * void erodeFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg)
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
- * Mat outImg : 出力画像
+ * int32_t kernelW : 構造要素の横幅
+ * int32_t kernelH : 構造要素の高さ
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
- * 機能 : メディアンフィルタ処理
+ * 機能 : 収縮処理 (構造要素内の最小値)
  *
  * return : void
  *************************************************/
-void ImageProcessor::medianFilter(Mat inImg, int32_t height, int32_t width, Mat outImg)
+void ImageProcessor::erodeFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg)
 {
-    int32_t filterSize = 3;
-    int32_t red[9], green[9], blue[9];
+    vhgwFilter<false>(inImg, height, width, kernelW, kernelH, borderType_, borderValue_, outImg);
+}
 
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            // 3x3のフィルタ処理(-1から1までの範囲)
-            int32_t idx = 0;
-            for (int32_t yy = -1; yy <= 1; yy++) {
-                for (int32_t xx = -1; xx <= 1; xx++) {
-                    // 画像の端の処理 (リピート)
-                    int32_t replicateY = std::clamp(y + yy, 0, height - 1);
-                    int32_t replicateX = std::clamp(x + xx, 0, width - 1);
+/*************************************************
+ * void dilateFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t kernelW : 構造要素の横幅
+ * int32_t kernelH : 構造要素の高さ
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 膨張処理 (構造要素内の最大値)
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::dilateFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH,
+                                  Mat outImg)
+{
+    vhgwFilter<true>(inImg, height, width, kernelW, kernelH, borderType_, borderValue_, outImg);
+}
+
+/*************************************************
+ * void openingFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t kernelW : 構造要素の横幅
+ * int32_t kernelH : 構造要素の高さ
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : オープニング処理 (収縮の後に膨張)、構造要素より小さい明るい点を除去
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::openingFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH,
+                                   Mat outImg)
+{
+    vhgwFilter<false>(inImg, height, width, kernelW, kernelH, borderType_, borderValue_, outImg);
+    vhgwFilter<true>(outImg, height, width, kernelW, kernelH, borderType_, borderValue_, outImg);
+}
+
+/*************************************************
+ * void closingFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t kernelW : 構造要素の横幅
+ * int32_t kernelH : 構造要素の高さ
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : クロージング処理 (膨張の後に収縮)、構造要素より小さい暗い穴を埋める
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::closingFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH,
+                                   Mat outImg)
+{
+    vhgwFilter<true>(inImg, height, width, kernelW, kernelH, borderType_, borderValue_, outImg);
+    vhgwFilter<false>(outImg, height, width, kernelW, kernelH, borderType_, borderValue_, outImg);
+}
+
+/*************************************************
+ * void boxFilter(Mat inImg, int32_t height, int32_t width, Mat radiusMap, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat radiusMap : 画素ごとのフィルタ係数 (CV_8UC1、窓は(2r+1)x(2r+1))
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 積分画像を用いた可変半径の平滑化フィルタ処理
+ *        窓の大きさによらず1画素あたり4回の参照で総和を求める
+ *        半径が一定ならequalizationFilterと同じ結果になる
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::boxFilter(Mat inImg, int32_t height, int32_t width, Mat radiusMap, Mat outImg)
+{
+    boxFilterTuned(inImg, height, width, radiusMap, tuning(IpsType::BoxFilter, height, width), outImg);
+}
 
-                    // 画素取得
-                    Vec3b &pix = inImg.at<Vec3b>(replicateY, replicateX);
+/*************************************************
+ * void boxFilterTuned(Mat inImg, int32_t height, int32_t width, Mat radiusMap, TuneConfig config, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat radiusMap : 画素ごとのフィルタ係数
+ * TuneConfig config : 呼び出し元の処理の実行時の設定
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 呼び出し元の処理の設定で可変半径の平滑化フィルタ処理を行う (処理の内容はboxFilterと同じ)
+ *        積分画像を作ってから出力するため、インプレース処理でも行の帯を並列に処理する
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::boxFilterTuned(Mat inImg, int32_t height, int32_t width, Mat radiusMap, TuneConfig config,
+                                    Mat outImg)
+{
+    // 最大半径分だけ外側をリピートした積分画像を作成
+    int32_t maxRadius = 0;
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t *radiusRow = radiusMap.ptr<uint8_t>(y);
+        int32_t        rowMax    = *std::max_element(radiusRow, radiusRow + width);
+        maxRadius                = std::max(maxRadius, rowMax);
+    }
 
-                    red[idx]   = pix[RED];
-                    green[idx] = pix[GREEN];
-                    blue[idx]  = pix[BLUE];
-                    idx++;
+    // 総和のみ使うため二乗の総和表は作らない
+    integral_.build(inImg, height, width, maxRadius, borderType_, borderValue_, false);
+
+    forEachStrip(height, config.tileRows, config.threadNum, [&](int32_t y0, int32_t y1) {
+        for (int32_t y = y0; y < y1; y++) {
+            const uint8_t *radiusRow = radiusMap.ptr<uint8_t>(y);
+            uint8_t       *dst       = outImg.ptr<uint8_t>(y);
+            for (int32_t x = 0; x < width; x++) {
+                int32_t  r    = radiusRow[x];
+                uint32_t area = (2 * r + 1) * (2 * r + 1);
+
+                // 窓内の画素値の平均
+                for (int32_t c = 0; c < 3; c++) {
+                    dst[x * 3 + c] =
+                        static_cast<uint8_t>(integral_.rectSum(x - r, y - r, x + r + 1, y + r + 1, c) / area);
                 }
             }
-            // 画素値のソート
-            std::sort(red, red + filterSize * filterSize);
-            std::sort(green, green + filterSize * filterSize);
-            std::sort(blue, blue + filterSize * filterSize);
+        }
+    });
+}
 
-            // 画素の書き込み
-            outImg.at<Vec3b>(y, x) = Vec3b(blue[4], green[4], red[4]);
+/*************************************************
+ * void adaptiveThresholdFilter(Mat inImg, int32_t height, int32_t width, int32_t blockRadius, double k, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t blockRadius : 局所領域の半径 (窓は(2r+1)x(2r+1))
+ * double k : 標準偏差の影響度 (0.2~0.5程度)
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 局所平均と局所分散を用いた適応的二値化 (Sauvolaの手法)
+ *        しきい値 T = mean * (1 + k * (stddev / 128 - 1))
+ *        積分画像を作ってから行の帯ごとに並列に処理する (スレッド数と帯の行数は自動調整の設定に従う)
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::adaptiveThresholdFilter(Mat inImg, int32_t height, int32_t width, int32_t blockRadius, double k,
+                                             Mat outImg)
+{
+    int32_t    r      = std::max(blockRadius, 0);
+    TuneConfig config = tuning(IpsType::AdaptiveThreshold, height, width);
+
+    integral_.build(inImg, height, width, r, borderType_, borderValue_);
+
+    forEachStrip(height, config.tileRows, config.threadNum, [&](int32_t y0, int32_t y1) {
+        for (int32_t y = y0; y < y1; y++) {
+            const uint8_t *src = inImg.ptr<uint8_t>(y);
+            uint8_t       *dst = outImg.ptr<uint8_t>(y);
+            for (int32_t x = 0; x < width; x++) {
+                for (int32_t c = 0; c < 3; c++) {
+                    // 局所領域の平均と標準偏差
+                    double mean   = integral_.rectMean(x - r, y - r, x + r + 1, y + r + 1, c);
+                    double stddev = std::sqrt(integral_.rectVariance(x - r, y - r, x + r + 1, y + r + 1, c));
+
+                    // しきい値処理 (同じ画素を読んでから書くため、インプレース処理でも帯を並列に処理できる)
+                    double threshold = mean * (1.0 + k * (stddev / 128.0 - 1.0));
+                    dst[x * 3 + c]   = src[x * 3 + c] > threshold ? 255 : 0;
+                }
+            }
         }
-    }
+    });
 }
 
 }  // namespace filter
@@ -1,14 +1,17 @@
 #pragma once
 
+#include "../border.h"
+#include "../integral/integral.h"
 #include <cstdint>
+#include <map>
 #include <opencv2/opencv.hpp>
+#include <utility>
+#include <vector>
 
 using namespace cv;
 
 namespace filter {
 
-#define FILTER_SIZE 3
-
 enum class IpsType
 {
     EqualizationFilter  = 0,
@@ -20,12 +23,111 @@ enum class IpsType
     RobertsFilter       = 6,
     EmbossingFilter     = 7,
     MedianFilter        = 8,
+    BilateralFilter     = 9,
+    ErodeFilter         = 10,
+    DilateFilter        = 11,
+    OpeningFilter       = 12,
+    ClosingFilter       = 13,
+    BoxFilter           = 14,
+    AdaptiveThreshold   = 15,
+    Convolution         = 16,
     None                = 99
 };
 
+// 画像の大きさの区分 (実行時の設定の単位)
+enum class SizeClass : int32_t
+{
+    Small  = 0,  // 1M画素未満
+    Medium = 1,  // 4M画素未満
+    Large  = 2,
+};
+
+// 処理の実装
+enum class Variant : int32_t
+{
+    Scalar   = 0,  // 既定の実装
+    Simd     = 1,  // SSE2で16画素値ずつ処理 (MedianFilter、勾配フィルタ)
+    Integral = 2,  // 積分画像 (EqualizationFilter)
+    Direct   = 3,  // FFTを使わない直接計算 (Convolution、部分画像でも画像全体と同じ丸めになる)
+};
+
+// 処理ごとの実行時の設定 (tune::Tunerで機種ごとに求める、結果はVariant::Directを除き設定によらず同じ)
+struct TuneConfig
+{
+    int32_t threadNum = 1;  // 行の帯を並列に処理するスレッド数 (インプレース処理では1)
+    int32_t tileRows  = 0;  // 帯の行数 (0の場合は高さ / threadNum)
+    Variant variant   = Variant::Scalar;
+};
+
+SizeClass sizeClassOf(int32_t height, int32_t width);
+
+// 3x3の固定のカーネル (ImageProcessorの各フィルタとpipelineで共有する)
+inline constexpr int32_t WEIGHTED_AVERAGE_KERNEL[3][3] = {
+    {1, 2, 1},
+    {2, 8, 2},
+    {1, 2, 1}
+};  // 加重平均フィルタ
+inline constexpr int32_t SHARPENING_KERNEL[3][3] = {
+    {0,  -1, 0 },
+    {-1, 5,  -1},
+    {0,  -1, 0 }
+};  // 先鋭化フィルタ(4近傍)
+inline constexpr int32_t EDGE_DETECTION_KERNEL_X[3][3] = {
+    {0, 0, 0 },
+    {1, 0, -1},
+    {0, 0, 0 }
+};  // 横フィルタ
+inline constexpr int32_t EDGE_DETECTION_KERNEL_Y[3][3] = {
+    {0, 1,  0},
+    {0, 0,  0},
+    {0, -1, 0}
+};  // 縦フィルタ
+inline constexpr int32_t SOBEL_KERNEL_X[3][3] = {
+    {1,  2,  1 },
+    {0,  0,  0 },
+    {-1, -2, -1}
+};  // 横方向のSobelフィルタ
+inline constexpr int32_t SOBEL_KERNEL_Y[3][3] = {
+    {1, 0, -1},
+    {2, 0, -2},
+    {1, 0, -1}
+};  // 縦方向のSobelフィルタ
+inline constexpr int32_t PREWITT_KERNEL_X[3][3] = {
+    {1,  1,  1 },
+    {0,  0,  0 },
+    {-1, -1, -1}
+};  // 横方向のPrewittフィルタ
+inline constexpr int32_t PREWITT_KERNEL_Y[3][3] = {
+    {1, 0, -1},
+    {1, 0, -1},
+    {1, 0, -1}
+};  // 縦方向のPrewittフィルタ
+inline constexpr int32_t ROBERTS_KERNEL_X[3][3] = {
+    {0, 0, 0 },
+    {0, 1, 0 },
+    {0, 0, -1}
+};  // 横方向のRobertsフィルタ
+inline constexpr int32_t ROBERTS_KERNEL_Y[3][3] = {
+    {0, 0,  0},
+    {0, 0,  1},
+    {0, -1, 0}
+};  // 縦方向のRobertsフィルタ
+inline constexpr int32_t EMBOSSING_KERNEL[3][3] = {
+    {0,  0, 0},
+    {-3, 0, 3},
+    {0,  0, 0}
+};  // エンボスフィルタ (数値を大きくするとエンボスの強さが増す)
+inline constexpr double EMBOSSING_DIVISOR = 6;    // フィルタの係数の絶対値 (割ることで画像のコントラストを調整)
+inline constexpr double EMBOSSING_BIAS    = 128;  // 中間の明るさ
+
+// 作業用バッファを保持するため、1つのインスタンスを複数のスレッドから同時に使わないこと
 class ImageProcessor
 {
 public:
+    void       setBorder(BorderType borderType, Vec3b borderValue = Vec3b(0, 0, 0));
+    void       setTuning(IpsType ipsType, SizeClass sizeClass, TuneConfig config);
+    TuneConfig tuning(IpsType ipsType, int32_t height, int32_t width) const;
+
     void equalizationFilter(Mat inImg, int32_t height, int32_t width, int32_t filterCoeff, Mat outImg);
     void weightedAverageFilter(Mat inImg, int32_t height, int32_t width, Mat outImg);
     void sharpeningFilter(Mat inImg, int32_t height, int32_t width, Mat outImg);
@@ -35,6 +137,35 @@ public:
     void robertsFilter(Mat inImg, int32_t height, int32_t width, Mat outImg);
     void embossingFilter(Mat inImg, int32_t height, int32_t width, Mat outImg);
     void medianFilter(Mat inImg, int32_t height, int32_t width, Mat outImg);
+    void bilateralFilter(Mat inImg, int32_t height, int32_t width, double sigmaSpace, double sigmaRange, Mat outImg);
+    void erodeFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg);
+    void dilateFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg);
+    void openingFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg);
+    void closingFilter(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, Mat outImg);
+    void boxFilter(Mat inImg, int32_t height, int32_t width, Mat radiusMap, Mat outImg);
+    void adaptiveThresholdFilter(Mat inImg, int32_t height, int32_t width, int32_t blockRadius, double k, Mat outImg);
+    void convolve(Mat inImg, int32_t height, int32_t width, Mat kernel, double divisor, double bias, Mat outImg);
+    void convolveRaw(Mat inImg, int32_t height, int32_t width, Mat kernel, Mat rawImg);
+
+private:
+    void gradientFilter(Mat inImg, int32_t height, int32_t width, Mat filter1, Mat filter2, TuneConfig config,
+                        Mat outImg);
+    void convolveTuned(Mat inImg, int32_t height, int32_t width, Mat kernel, double divisor, double bias,
+                       TuneConfig config, Mat outImg);
+    void boxFilterTuned(Mat inImg, int32_t height, int32_t width, Mat radiusMap, TuneConfig config, Mat outImg);
+    void bilateralDirect(Mat inImg, int32_t height, int32_t width, double sigmaSpace, double sigmaRange,
+                         int32_t radius, Mat outImg);
+
+    BorderType borderType_  = BorderType::Replicate;  // 画像の端の処理
+    Vec3b      borderValue_ = Vec3b(0, 0, 0);         // BorderType::Constantの画素値
+
+    // 処理と画像の大きさの区分ごとの実行時の設定 (設定のない処理は既定値)
+    std::map<std::pair<IpsType, SizeClass>, TuneConfig> tunings_;
+
+    // 処理をまたいで使い回す作業用バッファ (同じ大きさの画像を繰り返し処理する場合は確保し直さない)
+    integral::IntegralImage integral_;  // BoxFilter、AdaptiveThresholdの積分画像
+    std::vector<float>      grid_;      // BilateralFilterの1チャンネル分のバイラテラルグリッド
+    std::vector<float>      gridTmp_;
 };
 
 }  // namespace filter
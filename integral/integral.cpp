@@ -0,0 +1,176 @@
+#include "integral.h"
+#include <algorithm>
+
+namespace integral {
+/*************************************************
+ * void build(Mat inImg, int32_t height, int32_t width, int32_t pad, BorderType borderType, Vec3b borderValue,
+ *            bool squares)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t pad : 画像の外側に確保する画素数
+ * BorderType borderType : 外側の画素の端の処理
+ * Vec3b borderValue : BorderType::Constantの画素値
+ * bool squares : 二乗の総和表も作成する (falseの場合はrectSqSum、rectVarianceを使わないこと)
+ *
+ * 機能 : 総和表(と二乗の総和表)を作成
+ *        行を帯に分け、まず帯ごとの列方向の合計だけを並列に求めて各帯の直前までの累積を決め、
+ *        次に各帯がその累積から始めて表の行を並列に書き込む (表の各要素は1回だけ書き込む)
+ *
+ * return : void
+ *************************************************/
+void IntegralImage::build(Mat inImg, int32_t height, int32_t width, int32_t pad, BorderType borderType,
+                          Vec3b borderValue, bool squares)
+{
+    int32_t padH = height + 2 * pad;
+    int32_t padW = width + 2 * pad;
+    int32_t rowN = (padW + 1) * 3;
+
+    // 表はすべて上書きするため0で埋め直さない (大きさが変わらなければ確保もしない)
+    pad_    = pad;
+    tableW_ = padW + 1;
+    sum_.resize(static_cast<size_t>(padH + 1) * rowN);
+    std::fill_n(sum_.begin(), rowN, 0u);
+    if (squares) {
+        sqSum_.resize(static_cast<size_t>(padH + 1) * rowN);
+        std::fill_n(sqSum_.begin(), rowN, 0ull);
+    } else {
+        sqSum_.clear();
+    }
+
+    // 画像の端の処理をした列オフセット表 (Constantの範囲外は-1)
+    std::vector<int32_t> xTab(padW);
+    for (int32_t px = 0; px < padW; px++) {
+        int32_t srcX = borderIndex(px - pad, width, borderType);
+        xTab[px]     = srcX >= 0 ? srcX * 3 : -1;
+    }
+    std::vector<uint8_t> constRow(width * 3);
+    for (int32_t i = 0; i < width * 3; i++) {
+        constRow[i] = borderValue[i % 3];
+    }
+    auto srcRow = [&](int32_t py) {
+        int32_t srcY = borderIndex(py - pad, height, borderType);
+        return srcY >= 0 ? inImg.ptr<uint8_t>(srcY) : constRow.data();
+    };
+
+    // 帯の分割 (帯iは総和表の行bounds[i] + 1 ~ bounds[i + 1])
+    int32_t              strips = std::clamp(getNumThreads(), 1, std::max(padH, 1));
+    std::vector<int32_t> bounds(strips + 1);
+    for (int32_t i = 0; i <= strips; i++) {
+        bounds[i] = static_cast<int32_t>(static_cast<int64_t>(padH) * i / strips);
+    }
+
+    // 各帯の直前の行までの累積 (帯sの累積はsumCarryのs行目、帯0は0)
+    std::vector<uint32_t> sumCarry(static_cast<size_t>(strips) * rowN, 0);
+    std::vector<uint64_t> sqCarry(squares ? static_cast<size_t>(strips) * rowN : 0, 0);
+    if (strips > 1) {
+        // 最後の帯以外の、帯内の全行の行方向の累積和の合計 (表には書き込まない)
+        parallel_for_(Range(0, strips - 1), [&](const Range &range) {
+            for (int32_t s = range.start; s < range.end; s++) {
+                uint32_t *sumTotal = &sumCarry[static_cast<size_t>(s + 1) * rowN];
+                uint64_t *sqTotal  = squares ? &sqCarry[static_cast<size_t>(s + 1) * rowN] : nullptr;
+                for (int32_t py = bounds[s]; py < bounds[s + 1]; py++) {
+                    const uint8_t *src         = srcRow(py);
+                    uint32_t       rowSum[3]   = {0, 0, 0};
+                    uint64_t       rowSqSum[3] = {0, 0, 0};
+                    for (int32_t px = 0; px < padW; px++) {
+                        const uint8_t *pix = xTab[px] >= 0 ? src + xTab[px] : &borderValue[0];
+                        for (int32_t c = 0; c < 3; c++) {
+                            uint32_t v = pix[c];
+                            int32_t  i = (px + 1) * 3 + c;
+                            rowSum[c] += v;
+                            sumTotal[i] += rowSum[c];
+                            if (squares) {
+                                rowSqSum[c] += v * v;
+                                sqTotal[i] += rowSqSum[c];
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+        // 帯の数 x 1行分のみなので逐次で累積する
+        for (int32_t s = 2; s < strips; s++) {
+            for (int32_t i = 0; i < rowN; i++) {
+                sumCarry[static_cast<size_t>(s) * rowN + i] += sumCarry[static_cast<size_t>(s - 1) * rowN + i];
+                if (squares) {
+                    sqCarry[static_cast<size_t>(s) * rowN + i] += sqCarry[static_cast<size_t>(s - 1) * rowN + i];
+                }
+            }
+        }
+    }
+
+    // 帯ごとに直前までの累積から始めて表を作成
+    parallel_for_(Range(0, strips), [&](const Range &range) {
+        for (int32_t s = range.start; s < range.end; s++) {
+            const uint32_t *sumPrev = &sumCarry[static_cast<size_t>(s) * rowN];
+            const uint64_t *sqPrev  = squares ? &sqCarry[static_cast<size_t>(s) * rowN] : nullptr;
+            for (int32_t py = bounds[s]; py < bounds[s + 1]; py++) {
+                const uint8_t *src      = srcRow(py);
+                uint32_t      *sumRow   = &sum_[static_cast<size_t>(py + 1) * rowN];
+                uint64_t      *sqSumRow = squares ? &sqSum_[static_cast<size_t>(py + 1) * rowN] : nullptr;
+
+                uint32_t rowSum[3]   = {0, 0, 0};
+                uint64_t rowSqSum[3] = {0, 0, 0};
+                for (int32_t c = 0; c < 3; c++) {
+                    sumRow[c] = 0;
+                    if (squares) {
+                        sqSumRow[c] = 0;
+                    }
+                }
+
+                for (int32_t px = 0; px < padW; px++) {
+                    const uint8_t *pix = xTab[px] >= 0 ? src + xTab[px] : &borderValue[0];
+                    for (int32_t c = 0; c < 3; c++) {
+                        uint32_t v = pix[c];
+                        int32_t  i = (px + 1) * 3 + c;
+                        rowSum[c] += v;
+                        sumRow[i] = sumPrev[i] + rowSum[c];
+                        if (squares) {
+                            rowSqSum[c] += v * v;
+                            sqSumRow[i] = sqPrev[i] + rowSqSum[c];
+                        }
+                    }
+                }
+                sumPrev = sumRow;
+                sqPrev  = sqSumRow;
+            }
+        }
+    });
+}
+
+/*************************************************
+ * double rectMean(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch)
+ * int32_t x0, y0 : 矩形の左上 (含む)
+ * int32_t x1, y1 : 矩形の右下 (含まない)
+ * int32_t ch : チャンネル
+ *
+ * 機能 : 矩形内の画素値の平均
+ *
+ * return : double 平均値
+ *************************************************/
+double IntegralImage::rectMean(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch) const
+{
+    double area = static_cast<double>(x1 - x0) * (y1 - y0);
+    return rectSum(x0, y0, x1, y1, ch) / area;
+}
+
+/*************************************************
+ * double rectVariance(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch)
+ * int32_t x0, y0 : 矩形の左上 (含む)
+ * int32_t x1, y1 : 矩形の右下 (含まない)
+ * int32_t ch : チャンネル
+ *
+ * 機能 : 矩形内の画素値の分散
+ *
+ * return : double 分散
+ *************************************************/
+double IntegralImage::rectVariance(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch) const
+{
+    double area = static_cast<double>(x1 - x0) * (y1 - y0);
+    double mean = rectSum(x0, y0, x1, y1, ch) / area;
+    return std::max(0.0, rectSqSum(x0, y0, x1, y1, ch) / area - mean * mean);
+}
+
+}  // namespace integral
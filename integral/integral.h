@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../border.h"
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+using namespace cv;
+
+namespace integral {
+
+class IntegralImage
+{
+public:
+    void build(Mat inImg, int32_t height, int32_t width, int32_t pad = 0, BorderType borderType = BorderType::Replicate,
+               Vec3b borderValue = Vec3b(0, 0, 0), bool squares = true);
+
+    // 矩形[x0, x1) x [y0, y1)の画素値の総和 (座標は-pad ~ width + padの範囲)
+    // 総和表は32bitで桁あふれするが、矩形の総和が32bitに収まれば差分は正しく求まる
+    uint32_t rectSum(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch) const
+    {
+        return sum_[index(x1, y1, ch)] - sum_[index(x1, y0, ch)] - sum_[index(x0, y1, ch)] + sum_[index(x0, y0, ch)];
+    }
+
+    // 矩形[x0, x1) x [y0, y1)の画素値の二乗の総和
+    uint64_t rectSqSum(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch) const
+    {
+        return sqSum_[index(x1, y1, ch)] - sqSum_[index(x1, y0, ch)] - sqSum_[index(x0, y1, ch)] +
+               sqSum_[index(x0, y0, ch)];
+    }
+
+    double rectMean(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch) const;
+    double rectVariance(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t ch) const;
+
+private:
+    size_t index(int32_t x, int32_t y, int32_t ch) const
+    {
+        return (static_cast<size_t>(y + pad_) * tableW_ + (x + pad_)) * 3 + ch;
+    }
+
+    int32_t               pad_    = 0;
+    int32_t               tableW_ = 0;
+    std::vector<uint32_t> sum_;    // 画素値の総和表
+    std::vector<uint64_t> sqSum_;  // 画素値の二乗の総和表
+};
+
+}  // namespace integral
@@ -1,17 +1,86 @@
+#include "batch/batch.h"
+#include "cache/cache.h"
 #include "filter/filter.h"
+#include "pipeline/pipeline.h"
 #include "pixelwise/pixelwise.h"
+#include "preview/preview.h"
+#include "roi/roi.h"
+#include "server/server.h"
+#include "tiled/tiled.h"
+#include "tune/tune.h"
 #include <cstdint>
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <vector>
 
 using namespace cv;
 
 void createHist(Mat img, Mat imgHist, const double fixedHistMax);
 
-int32_t main()
+// 起動時の指定 (コマンドライン引数)
+struct Options {
+    bool        autoTune    = false;              // --tune
+    bool        daemonMode  = false;              // --daemon
+    bool        batchMode   = false;              // --batch
+    bool        sweep       = false;              // --sweep
+    bool        useTiled    = false;              // --tiled
+    bool        usePipeline = false;              // --pipeline
+    std::string inputPath   = "./data/Girl.bmp";  // --input <path>
+};
+
+bool parseArgs(int32_t argc, char *argv[], Options &options);
+
+int32_t main(int32_t argc, char *argv[])
 {
-    Mat img = imread("./data/Girl.bmp");
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0] << " [--tune] [--daemon | --batch | --sweep | --tiled | --pipeline]"
+                  << " [--input <path>]" << std::endl;
+        return 1;
+    }
+
+    // 自動調整 (--tuneの場合、初回は機種ごとに最速の設定を計測してプロファイルに保存し、以降は読み込んで使う)
+    // プロファイルは1回だけ読み込み、デーモンとバッチ処理では各ワーカのフィルタ処理に同じ設定を指定する
+    bool          autoTune = options.autoTune;
+    tune::Profile profile;
+    if (autoTune) {
+        tune::loadOrTune("./tune_profile.txt", profile);
+    }
+
+    // デーモンモード (--daemonの場合、Unixドメインソケットで要求を受け付けて常駐する)
+    bool daemonMode = options.daemonMode;
+    if (daemonMode) {
+        server::Server ipsServer("/tmp/ips_c_sample.sock");
+        ipsServer.setProfile(profile);
+        return ipsServer.run() ? 0 : 1;
+    }
+
+    // バッチ処理 (--batchの場合、ジョブの一覧の画像を複数のワーカプロセスで処理して終了)
+    bool batchMode = options.batchMode;
+    if (batchMode) {
+        std::vector<batch::Job> jobs;
+        if (!batch::readJobList("./data/jobs.txt", jobs)) {
+            return 1;
+        }
+        batch::Coordinator coordinator;
+        coordinator.setProfile(profile);
+        batch::BatchResult result = coordinator.run(jobs);
+        for (const batch::WorkerStats &stats : result.workers) {
+            std::cout << "worker " << stats.pid << " node " << stats.node << " : " << stats.jobsDone << " images, "
+                      << stats.imagesPerSec() << " images/s, stolen " << stats.stolen << ", restarts " << stats.restarts
+                      << std::endl;
+        }
+        std::cout << "total : " << result.jobsDone << " images, " << result.imagesPerSec() << " images/s, failed "
+                  << result.failedJobs.size() << std::endl;
+        return result.failedJobs.empty() ? 0 : 1;
+    }
+
+    Mat img = imread(options.inputPath);
+    if (img.empty()) {
+        std::cerr << "cannot read " << options.inputPath << std::endl;
+        return 1;
+    }
 
     int32_t height = img.rows;
     int32_t width  = img.cols;
@@ -25,91 +94,246 @@ int32_t main()
     pixelwise::ImageProcessor ips;
     pixelwise::IpsType        ipsType = pixelwise::IpsType::None;
 
+    // パラメータスイープ (--sweepの場合、全パラメータの組み合わせの出力画像を保存して終了)
+    bool                sweep        = options.sweep;
+    pixelwise::IpsType  sweepType    = pixelwise::IpsType::Gamma;
+    std::vector<double> sweepValues1 = {0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 1.0, 1.2, 1.5, 2.0};  // coeff, a, gammaVal, k
+    std::vector<double> sweepValues2 = {};                                                  // b, x0
+    if (sweep) {
+        std::vector<Mat> outImgs;
+        ips.paramSweep(img, height, width, sweepType, sweepValues1, sweepValues2, outImgs);
+        for (size_t i = 0; i < outImgs.size(); i++) {
+            imwrite(outName + "Sweep" + std::to_string(i) + extName, outImgs[i]);
+        }
+        return 0;
+    }
+
     // フィルタ処理
     filter::ImageProcessor ips2;
-    filter::IpsType        ipsType2 = filter::IpsType::MedianFilter;
+    filter::IpsType        ipsType2   = filter::IpsType::MedianFilter;
+    BorderType             borderType = BorderType::Replicate;  // 画像の端 (Replicate, Reflect101, Constant, Wrap)
+    ips2.setBorder(borderType);
+    profile.apply(ips2);
+
+    // タイル形式 (--tiledの場合、初回はBMPをタイル形式に変換し、縮小画像の中央の領域を処理して保存して終了)
+    // 領域を処理の参照範囲だけ広げた窓のタイルだけを読み込む
+    bool    useTiled   = options.useTiled;
+    int32_t tiledLevel = 1;  // 0が等倍、1が1/2
+    if (useTiled) {
+        tiled::TiledImage tiledImg;
+        std::string tiledPath = options.inputPath.substr(0, options.inputPath.find_last_of('.')) + ".tiled";
+        if (!tiledImg.open(tiledPath) &&
+            !(tiled::convertBmp(options.inputPath, tiledPath) && tiledImg.open(tiledPath))) {
+            std::cerr << "cannot open " << tiledPath << std::endl;
+            return 1;
+        }
+        if (tiledLevel < 0 || tiledLevel >= tiledImg.levels()) {
+            std::cerr << "level " << tiledLevel << " is out of range (" << tiledImg.levels() << " levels)" << std::endl;
+            return 1;
+        }
+
+        int32_t levelH     = tiledImg.height(tiledLevel);
+        int32_t levelW     = tiledImg.width(tiledLevel);
+        Rect    rect       = Rect(levelW / 4, levelH / 4, levelW / 2, levelH / 2);
+        int32_t kernelSize = preview::scaleKernelSize(9, 1.0 / (1 << tiledLevel));  // 等倍での9x9を縮小率に合わせる
+
+        server::Request request;
+        request.module     = server::Module::Filter;
+        request.ipsType    = static_cast<int32_t>(filter::IpsType::OpeningFilter);
+        request.params[0]  = kernelSize;
+        request.params[1]  = kernelSize;
+        request.borderType = static_cast<int32_t>(borderType);
+
+        Mat            regionImg = Mat{rect.height, rect.width, CV_8UC3, Scalar(0, 0, 0)};
+        server::Status status    = server::Status::BadRequest;
+        bool           ok        = tiledImg.process(
+            rect, tiledLevel, roi::filterRadius(filter::IpsType::OpeningFilter, kernelSize, kernelSize), borderType,
+            [&](Mat inImg, int32_t h, int32_t w, Rect, Mat windowOut) {
+                request.height = h;
+                request.width  = w;
+                status         = server::processFrame(request, inImg, windowOut, ips, ips2);
+            },
+            regionImg);
+        if (!ok || status != server::Status::Ok) {
+            std::cerr << "cannot process the region of " << tiledPath << std::endl;
+            return 1;
+        }
+        imwrite(outName + "TiledRegion" + extName, regionImg);
+        return 0;
+    }
+
+    // 処理の融合 (--pipelineの場合、濃淡処理とフィルタ処理の並びを1回の走査で実行して保存して終了)
+    // 中間画像を作らず、各処理を順に実行した場合と同じ結果になる
+    bool usePipeline = options.usePipeline;
+    if (usePipeline) {
+        auto fused = pipeline::nega() | pipeline::gamma(0.7) | pipeline::sharpening() | pipeline::sobel();
+        fused.setBorder(borderType);
+        fused.run(img, height, width, outImg);
+        imwrite(outName + "Pipeline" + extName, outImg);
+        return 0;
+    }
 
     double  coeff, a, b, gammaVal, k, x0;
     int32_t filterCoeff;
+    double  sigmaSpace, sigmaRange;
+    int32_t kernelW, kernelH;
+    int32_t blockRadius;
+    int32_t kernel[5][5] = {
+        {1, 4,  6,  4,  1},
+        {4, 16, 24, 16, 4},
+        {6, 24, 36, 24, 6},
+        {4, 16, 24, 16, 4},
+        {1, 4,  6,  4,  1}
+    };  // 5x5の二項分布フィルタ (分離可能)
+
+    // 処理結果のキャッシュ (同じ入力画素、処理、パラメータ、端の処理の結果は処理を省略する)
+    cache::ResultCache resultCache(server::DEFAULT_CACHE_BYTES);
+
+    // 処理の指定 (paramsの意味はserver::processFrameと同じ)
+    server::Request request;
+    request.height  = height;
+    request.width   = width;
+    request.module  = server::Module::Pixelwise;
+    request.ipsType = static_cast<int32_t>(ipsType);
 
     switch (ipsType) {
     case pixelwise::IpsType::ToneCurve:
-        coeff = 2;
-        ips.toneCurve(img, height, width, coeff, outImg);
-        ipsName = "ToneCurve";
+        coeff             = 2;
+        request.params[0] = coeff;
+        ipsName           = "ToneCurve";
         break;
     case pixelwise::IpsType::Linear:
-        a = 1.;  // コントラストが変わる
-        b = 50;  // 明るさが変わる
-        ips.effectLinear(img, height, width, a, b, outImg);
-        ipsName = "Linear";
+        a                 = 1.;  // コントラストが変わる
+        b                 = 50;  // 明るさが変わる
+        request.params[0] = a;
+        request.params[1] = b;
+        ipsName           = "Linear";
         break;
     case pixelwise::IpsType::Nega:
-        ips.effectNega(img, height, width, outImg);
         ipsName = "Nega";
         break;
     case pixelwise::IpsType::Gamma:
-        gammaVal = 0.7;
-        ips.effectGamma(img, height, width, gammaVal, outImg);
-        ipsName = "Gamma";
+        gammaVal          = 0.7;
+        request.params[0] = gammaVal;
+        ipsName           = "Gamma";
         break;
     case pixelwise::IpsType::Sigmoid:
-        k  = 1;
-        x0 = 0.5;
-        ips.effectSigmoid(img, height, width, k, x0, outImg);
-        ipsName = "Sigmoid";
+        k                 = 1;
+        x0                = 0.5;
+        request.params[0] = k;
+        request.params[1] = x0;
+        ipsName           = "Sigmoid";
         break;
     case pixelwise::IpsType::HistEqualization:
-        ips.histEqualization(img, height, width, outImg);
         ipsName = "HistEqualization";
         break;
+    case pixelwise::IpsType::HistEqualizationLuma:
+        ipsName = "HistEqualizationLuma";
+        break;
     default:
         // 何もしない
         break;
     }
+    if (ipsType != pixelwise::IpsType::None) {
+        server::processFrame(request, img, outImg, ips, ips2, &resultCache);
+    }
+
+    request            = server::Request{};
+    request.height     = height;
+    request.width      = width;
+    request.module     = server::Module::Filter;
+    request.ipsType    = static_cast<int32_t>(ipsType2);
+    request.borderType = static_cast<int32_t>(borderType);
 
     switch (ipsType2) {
     case filter::IpsType::EqualizationFilter:
-        filterCoeff = 2;
-        ips2.equalizationFilter(img, height, width, filterCoeff, outImg);
-        ipsName = "EqualizationFilter";
+        filterCoeff       = 2;
+        request.params[0] = filterCoeff;
+        ipsName           = "EqualizationFilter";
         break;
     case filter::IpsType::WeightedAverage:
-        ips2.weightedAverageFilter(img, height, width, outImg);
         ipsName = "WeightedAverage";
         break;
     case filter::IpsType::SharpeningFilter:
-        ips2.sharpeningFilter(img, height, width, outImg);
         ipsName = "SharpeningFilter";
         break;
     case filter::IpsType::EdgeDetectionFilter:
-        ips2.edgeDetectionFilter(img, height, width, outImg);
         ipsName = "EdgeDetectionFilter";
         break;
     case filter::IpsType::SobelFilter:
-        ips2.sobelFilter(img, height, width, outImg);
         ipsName = "SobelFilter";
         break;
     case filter::IpsType::PrewittFilter:
-        ips2.prewittFilter(img, height, width, outImg);
         ipsName = "PrewittFilter";
         break;
     case filter::IpsType::RobertsFilter:
-        ips2.robertsFilter(img, height, width, outImg);
         ipsName = "RobertsFilter";
         break;
     case filter::IpsType::EmbossingFilter:
-        ips2.embossingFilter(img, height, width, outImg);
         ipsName = "EmbossingFilter";
         break;
     case filter::IpsType::MedianFilter:
-        ips2.medianFilter(img, height, width, outImg);
         ipsName = "MedianFilter";
         break;
+    case filter::IpsType::BilateralFilter:
+        sigmaSpace        = 16;  // 大きいほど広い範囲を平滑化
+        sigmaRange        = 30;  // 小さいほどエッジを保持
+        request.params[0] = sigmaSpace;
+        request.params[1] = sigmaRange;
+        ipsName           = "BilateralFilter";
+        break;
+    case filter::IpsType::ErodeFilter:
+        kernelW           = 5;
+        kernelH           = 5;
+        request.params[0] = kernelW;
+        request.params[1] = kernelH;
+        ipsName           = "ErodeFilter";
+        break;
+    case filter::IpsType::DilateFilter:
+        kernelW           = 5;
+        kernelH           = 5;
+        request.params[0] = kernelW;
+        request.params[1] = kernelH;
+        ipsName           = "DilateFilter";
+        break;
+    case filter::IpsType::OpeningFilter:
+        kernelW           = 5;
+        kernelH           = 5;
+        request.params[0] = kernelW;
+        request.params[1] = kernelH;
+        ipsName           = "OpeningFilter";
+        break;
+    case filter::IpsType::ClosingFilter:
+        kernelW           = 5;
+        kernelH           = 5;
+        request.params[0] = kernelW;
+        request.params[1] = kernelH;
+        ipsName           = "ClosingFilter";
+        break;
+    case filter::IpsType::BoxFilter:
+        filterCoeff       = 2;  // 画素ごとに変える場合はboxFilterに半径の画像を渡す
+        request.params[0] = filterCoeff;
+        ipsName           = "BoxFilter";
+        break;
+    case filter::IpsType::AdaptiveThreshold:
+        blockRadius       = 7;
+        k                 = 0.2;
+        request.params[0] = blockRadius;
+        request.params[1] = k;
+        ipsName           = "AdaptiveThreshold";
+        break;
+    case filter::IpsType::Convolution:
+        // カーネルは要求に含められないため直接呼ぶ
+        ips2.convolve(img, height, width, Mat{5, 5, CV_32SC1, kernel}, 256, 0, outImg);
+        ipsName = "Convolution";
+        break;
     default:
         // 何もしない
         break;
     }
+    if (ipsType2 != filter::IpsType::None && ipsType2 != filter::IpsType::Convolution) {
+        server::processFrame(request, img, outImg, ips, ips2, &resultCache);
+    }
 
     // どちらも処理がない場合入力画像をそのまま出力
     if (ipsType == pixelwise::IpsType::None && ipsType2 == filter::IpsType::None) {
@@ -133,6 +357,48 @@ int32_t main()
     return 0;
 }
 
+/*************************************************
+ * bool parseArgs(int32_t argc, char *argv[], Options &options)
+ * int32_t argc : 引数の数
+ * char *argv[] : 引数
+ * Options &options : 起動時の指定 (指定のない項目は初期値のまま)
+ *
+ * 機能 : コマンドライン引数を解釈
+ *        --daemon, --batch, --sweep, --tiled, --pipelineは処理して終了するため、同時に1つだけ指定できる
+ *
+ * return : bool 不明な引数、値のない--input、複数のモードの指定のいずれもない場合はtrue
+ *************************************************/
+bool parseArgs(int32_t argc, char *argv[], Options &options)
+{
+    int32_t modes = 0;
+    for (int32_t i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--tune") {
+            options.autoTune = true;
+        } else if (arg == "--daemon") {
+            options.daemonMode = true;
+            modes++;
+        } else if (arg == "--batch") {
+            options.batchMode = true;
+            modes++;
+        } else if (arg == "--sweep") {
+            options.sweep = true;
+            modes++;
+        } else if (arg == "--tiled") {
+            options.useTiled = true;
+            modes++;
+        } else if (arg == "--pipeline") {
+            options.usePipeline = true;
+            modes++;
+        } else if (arg == "--input" && i + 1 < argc) {
+            options.inputPath = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return modes <= 1;
+}
+
 /*************************************************
  * void createHist(Mat img, Mat imgHist)
  * Mat img : 入力画像
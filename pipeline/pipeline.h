@@ -0,0 +1,705 @@
+#pragma once
+
+#include "../border.h"
+#include "../filter/filter.h"
+#include "../pixelwise/pixelwise.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <opencv2/opencv.hpp>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace cv;
+
+namespace pipeline {
+
+// 画素値のみで決まる処理 (pixelwise::ImageProcessorの処理をLUTに畳み込んで適用する)
+template <class Fn>
+struct Point
+{
+    static constexpr bool    IS_POINT = true;
+    static constexpr bool    FUSABLE  = true;
+    static constexpr int32_t RADIUS_Y = 0;
+    static constexpr int32_t RADIUS_X = 0;
+
+    Fn fn;  // fn(pixelwise::ImageProcessor &ips, Mat inImg, int32_t height, int32_t width, Mat outImg)
+};
+
+// 近傍の処理の各段は、近傍のi行j列の画素値を返すpixel(i, j)から出力の画素値を求めるeval()を持つ
+// (端の列では端の処理をした画素値、内側の列では行の画素値を直接渡す)
+
+// KH x KWのカーネルによる畳み込み(相関)処理 (filter::ImageProcessor::convolveと同じ結果)
+template <int32_t KH, int32_t KW>
+struct Convolve
+{
+    static constexpr bool    IS_POINT = false;
+    static constexpr bool    FUSABLE  = true;
+    static constexpr int32_t KERNEL_H = KH;
+    static constexpr int32_t KERNEL_W = KW;
+    static constexpr int32_t RADIUS_Y = KH / 2;
+    static constexpr int32_t RADIUS_X = KW / 2;
+
+    int32_t kernel[KH][KW];
+    double  divisor;
+    double  bias;
+
+    template <class Pixel>
+    uint8_t eval(const Pixel &pixel) const
+    {
+        int32_t sum = 0;
+        for (int32_t i = 0; i < KH; i++) {
+            for (int32_t j = 0; j < KW; j++) {
+                sum += kernel[i][j] * pixel(i, j);
+            }
+        }
+
+        // 画素値の正規化、0~255に収める
+        double v = std::trunc(sum / divisor) + bias;
+        return static_cast<uint8_t>(std::clamp(v, 0., 255.));
+    }
+};
+
+// 2方向のKH x KWのカーネルによる勾配の大きさ (filter::ImageProcessorのSobelフィルタなどと同じ結果)
+template <int32_t KH, int32_t KW>
+struct Gradient
+{
+    static constexpr bool    IS_POINT = false;
+    static constexpr bool    FUSABLE  = true;
+    static constexpr int32_t KERNEL_H = KH;
+    static constexpr int32_t KERNEL_W = KW;
+    static constexpr int32_t RADIUS_Y = KH / 2;
+    static constexpr int32_t RADIUS_X = KW / 2;
+
+    int32_t kernelX[KH][KW];
+    int32_t kernelY[KH][KW];
+
+    template <class Pixel>
+    uint8_t eval(const Pixel &pixel) const
+    {
+        int32_t gx = 0, gy = 0;
+        for (int32_t i = 0; i < KH; i++) {
+            for (int32_t j = 0; j < KW; j++) {
+                int32_t v = pixel(i, j);
+                gx += kernelX[i][j] * v;
+                gy += kernelY[i][j] * v;
+            }
+        }
+
+        // 画素値の平方根、0~255に収める
+        double mag = std::sqrt(static_cast<double>(gx) * gx + static_cast<double>(gy) * gy);
+        return static_cast<uint8_t>(std::clamp(mag, 0., 255.));
+    }
+};
+
+// 3x3の中央値 (filter::ImageProcessor::medianFilterと同じ結果)
+struct Median
+{
+    static constexpr bool    IS_POINT = false;
+    static constexpr bool    FUSABLE  = true;
+    static constexpr int32_t KERNEL_H = 3;
+    static constexpr int32_t KERNEL_W = 3;
+    static constexpr int32_t RADIUS_Y = 1;
+    static constexpr int32_t RADIUS_X = 1;
+
+    template <class Pixel>
+    uint8_t eval(const Pixel &pixel) const
+    {
+        uint8_t v[9];
+        for (int32_t i = 0; i < 3; i++) {
+            for (int32_t j = 0; j < 3; j++) {
+                v[i * 3 + j] = static_cast<uint8_t>(pixel(i, j));
+            }
+        }
+        std::nth_element(v, v + 4, v + 9);
+        return v[4];
+    }
+};
+
+// 融合しない処理 (filter::ImageProcessorの処理を画像全体に行う)
+// この段を含む処理の並びは、RuntimePipelineで1段ずつ実行する
+struct Whole
+{
+    static constexpr bool    IS_POINT = false;
+    static constexpr bool    FUSABLE  = false;
+    static constexpr int32_t RADIUS_Y = 0;  // 参照範囲は処理による (Pipeline::RADIUS_Yには含めない)
+    static constexpr int32_t RADIUS_X = 0;
+
+    // fn(filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg)
+    std::function<void(filter::ImageProcessor &, Mat, int32_t, int32_t, Mat)> fn;
+};
+
+namespace detail {
+
+// 処理段の出力行を昇順に計算し、下流の段が参照する行だけをリングバッファに保持する
+template <class Derived>
+class CachedRows
+{
+public:
+    // 出力の行 (yは範囲外でもよい、Constantの範囲外は定数の行)
+    const uint8_t *row(int32_t y)
+    {
+        int32_t srcY = borderIndex(y, height_, borderType_);
+        if (srcY < 0) {
+            return constRow_.data();
+        }
+        while (computed_ <= srcY) {
+            static_cast<Derived *>(this)->compute(computed_, slot(computed_));
+            computed_++;
+        }
+        return slot(srcY);
+    }
+
+    // 画素値のみで決まる処理を出力のLUTに合成する
+    template <class Fn>
+    void addPoint(const Fn &fn)
+    {
+        Mat lutImg = Mat{1, 256, CV_8UC3};
+        for (int32_t i = 0; i < 256; i++) {
+            for (int32_t c = 0; c < 3; c++) {
+                lutImg.ptr<uint8_t>(0)[i * 3 + c] = lut_[c][i];
+            }
+        }
+
+        pixelwise::ImageProcessor ips;
+        fn(ips, lutImg, 1, 256, lutImg);
+
+        for (int32_t i = 0; i < 256; i++) {
+            for (int32_t c = 0; c < 3; c++) {
+                lut_[c][i] = lutImg.ptr<uint8_t>(0)[i * 3 + c];
+            }
+        }
+    }
+
+protected:
+    // keepRows : 下流の段が同時に参照する行数 (0なら保持しない)
+    void initRows(int32_t height, int32_t width, BorderType borderType, Vec3b borderValue, int32_t keepRows)
+    {
+        height_     = height;
+        rowBytes_   = width * 3;
+        borderType_ = borderType;
+        computed_   = 0;
+
+        // Wrapは上端で下端の行を参照するため全行を保持
+        keepRows_ = (keepRows > 0 && borderType == BorderType::Wrap) ? height : std::min(keepRows, height);
+        ring_.assign(static_cast<size_t>(std::max(keepRows_, 0)) * rowBytes_, 0);
+
+        constRow_.resize(rowBytes_);
+        for (int32_t i = 0; i < rowBytes_; i++) {
+            constRow_[i] = borderValue[i % 3];
+        }
+
+        for (int32_t i = 0; i < 256; i++) {
+            lut_[0][i] = lut_[1][i] = lut_[2][i] = static_cast<uint8_t>(i);
+        }
+    }
+
+    uint8_t *slot(int32_t y) { return &ring_[static_cast<size_t>(y % keepRows_) * rowBytes_]; }
+
+    int32_t              height_   = 0;
+    int32_t              rowBytes_ = 0;
+    BorderType           borderType_;
+    int32_t              keepRows_ = 0;
+    int32_t              computed_ = 0;  // 計算済みの行数
+    std::vector<uint8_t> ring_;
+    std::vector<uint8_t> constRow_;
+    uint8_t              lut_[3][256];  // 出力に適用するLUT
+};
+
+// 入力画像 (画素値のみで決まる処理を適用)
+class SourceLevel : public CachedRows<SourceLevel>
+{
+public:
+    static constexpr int32_t DEPTH = 0;
+
+    void init(Mat img, int32_t height, int32_t width, BorderType borderType, Vec3b borderValue, int32_t keepRows)
+    {
+        img_ = img;
+        initRows(height, width, borderType, borderValue, keepRows);
+    }
+
+    void compute(int32_t y, uint8_t *dst)
+    {
+        const uint8_t *src = img_.ptr<uint8_t>(y);
+        for (int32_t i = 0; i < rowBytes_; i += 3) {
+            dst[i]     = lut_[0][src[i]];
+            dst[i + 1] = lut_[1][src[i + 1]];
+            dst[i + 2] = lut_[2][src[i + 2]];
+        }
+    }
+
+    template <int32_t K>
+    SourceLevel &level()
+    {
+        static_assert(K == DEPTH);
+        return *this;
+    }
+
+private:
+    Mat img_;
+};
+
+// 近傍の処理 (上流の段の出力行を参照し、近傍の処理の後に画素値のみで決まる処理を適用)
+template <class Stencil, class Upstream>
+class StencilLevel : public CachedRows<StencilLevel<Stencil, Upstream>>
+{
+public:
+    static constexpr int32_t DEPTH = Upstream::DEPTH + 1;
+
+    void init(Mat img, int32_t height, int32_t width, BorderType borderType, Vec3b borderValue, int32_t keepRows)
+    {
+        up_.init(img, height, width, borderType, borderValue, 2 * Stencil::RADIUS_Y + 1);
+        this->initRows(height, width, borderType, borderValue, keepRows);
+
+        width_       = width;
+        borderValue_ = borderValue;
+        xTab_.resize(width + Stencil::KERNEL_W - 1);
+        for (int32_t i = 0; i < width + Stencil::KERNEL_W - 1; i++) {
+            int32_t srcX = borderIndex(i - Stencil::RADIUS_X, width, borderType);
+            xTab_[i]     = srcX >= 0 ? srcX * 3 : -1;
+        }
+    }
+
+    void setStencil(const Stencil &stencil) { stencil_ = stencil; }
+
+    void compute(int32_t y, uint8_t *dst)
+    {
+        const uint8_t *rows[Stencil::KERNEL_H];
+        for (int32_t i = 0; i < Stencil::KERNEL_H; i++) {
+            rows[i] = up_.row(y + i - Stencil::RADIUS_Y);
+        }
+
+        // 端の列 (列オフセット表で端の処理をする)
+        auto edgePixel = [&](int32_t x) {
+            for (int32_t c = 0; c < 3; c++) {
+                uint8_t v = stencil_.eval([&](int32_t i, int32_t j) {
+                    int32_t offset = xTab_[x + j];
+                    return offset >= 0 ? rows[i][offset + c] : borderValue_[c];
+                });
+                dst[x * 3 + c] = this->lut_[c][v];
+            }
+        };
+
+        // 内側の列 (近傍がすべて画像内のため、行の画素値を直接参照する)
+        int32_t interiorBegin = std::min(Stencil::RADIUS_X, width_);
+        int32_t interiorEnd   = std::max(width_ - (Stencil::KERNEL_W - 1 - Stencil::RADIUS_X), interiorBegin);
+
+        for (int32_t x = 0; x < interiorBegin; x++) {
+            edgePixel(x);
+        }
+        for (int32_t x = interiorBegin; x < interiorEnd; x++) {
+            int32_t left = (x - Stencil::RADIUS_X) * 3;
+            for (int32_t c = 0; c < 3; c++) {
+                uint8_t v = stencil_.eval([&](int32_t i, int32_t j) { return rows[i][left + j * 3 + c]; });
+                dst[x * 3 + c] = this->lut_[c][v];
+            }
+        }
+        for (int32_t x = interiorEnd; x < width_; x++) {
+            edgePixel(x);
+        }
+    }
+
+    template <int32_t K>
+    auto &level()
+    {
+        if constexpr (K == DEPTH) {
+            return *this;
+        } else {
+            return up_.template level<K>();
+        }
+    }
+
+private:
+    Upstream             up_;
+    Stencil              stencil_;
+    int32_t              width_ = 0;
+    Vec3b                borderValue_;
+    std::vector<int32_t> xTab_;
+};
+
+// 処理の並びから段の型を組み立てる (画素値のみで決まる処理は直前の段のLUTに畳み込む)
+template <class Upstream, class... Stages>
+struct BuildLevels
+{
+    using type = Upstream;
+};
+
+template <class Upstream, class Fn, class... Rest>
+struct BuildLevels<Upstream, Point<Fn>, Rest...>
+{
+    using type = typename BuildLevels<Upstream, Rest...>::type;
+};
+
+template <class Upstream, class Stage, class... Rest>
+struct BuildLevels<Upstream, Stage, Rest...>
+{
+    using type = typename BuildLevels<StencilLevel<Stage, Upstream>, Rest...>::type;
+};
+
+}  // namespace detail
+
+/*************************************************
+ * 処理の並びが実行時に決まる場合のパイプライン
+ *
+ * 各処理を順に出力画像へインプレースで実行する (処理ごとに画像全体を走査する)
+ *************************************************/
+class RuntimePipeline
+{
+public:
+    using Step = std::function<void(Mat inImg, int32_t height, int32_t width, Mat outImg)>;
+
+    void add(Step step) { steps_.push_back(std::move(step)); }
+
+    /*************************************************
+     * void run(Mat inImg, int32_t height, int32_t width, Mat outImg)
+     * Mat inImg : 入力画像
+     * int32_t height : 高さ
+     * int32_t width : 横幅
+     * Mat outImg : 出力画像 (inImgと同じでもよい)
+     *
+     * 機能 : 追加した処理を順に実行する
+     *
+     * return : void
+     *************************************************/
+    void run(Mat inImg, int32_t height, int32_t width, Mat outImg) const
+    {
+        if (steps_.empty()) {
+            if (inImg.data != outImg.data) {
+                inImg.copyTo(outImg);
+            }
+            return;
+        }
+
+        steps_[0](inImg, height, width, outImg);
+        for (size_t i = 1; i < steps_.size(); i++) {
+            steps_[i](outImg, height, width, outImg);
+        }
+    }
+
+private:
+    std::vector<Step> steps_;
+};
+
+/*************************************************
+ * 処理の並びをコンパイル時に1つの処理に融合するパイプライン
+ *
+ * 例 : auto p = pipeline::nega() | pipeline::gamma(0.7) | pipeline::sharpening();
+ *      p.run(inImg, height, width, outImg);
+ *
+ * 画素値のみで決まる処理は連続するものを1つのLUTにまとめ、近傍の処理の読み込み時または書き込み時に適用する
+ * 近傍の処理の参照範囲はコンパイル時に決まり、各段は下流が参照する行数だけをリングバッファに保持する
+ * (中間画像は作らない、BorderType::Wrapのみ各段で全行を保持する)
+ * 融合しない処理(Whole)を含む場合は、自動的にRuntimePipelineで1段ずつ実行する
+ * 処理の並びが実行時に決まる場合はRuntimePipelineを使う
+ *************************************************/
+template <class... Stages>
+class Pipeline
+{
+public:
+    // すべての処理を融合できるか
+    static constexpr bool FUSED = (true && ... && Stages::FUSABLE);
+
+    // 処理全体の参照範囲 (中心からの画素数、FUSEDの場合のみ)
+    static constexpr int32_t RADIUS_Y = (0 + ... + Stages::RADIUS_Y);
+    static constexpr int32_t RADIUS_X = (0 + ... + Stages::RADIUS_X);
+
+    explicit Pipeline(std::tuple<Stages...> stages) : stages_(std::move(stages)) {}
+
+    // 処理の連結
+    template <class... Others>
+    Pipeline<Stages..., Others...> operator|(const Pipeline<Others...> &other) const
+    {
+        Pipeline<Stages..., Others...> joined(std::tuple_cat(stages_, other.stages_));
+        joined.setBorder(borderType_, borderValue_);
+        return joined;
+    }
+
+    /*************************************************
+     * void setBorder(BorderType borderType, Vec3b borderValue)
+     * BorderType borderType : 画像の端の処理 (デフォルト: リピート)
+     * Vec3b borderValue : BorderType::Constantの画素値
+     *
+     * 機能 : 近傍の処理で画像の端の外側を参照したときの画素の決め方を設定
+     *
+     * return : void
+     *************************************************/
+    void setBorder(BorderType borderType, Vec3b borderValue = Vec3b(0, 0, 0))
+    {
+        borderType_  = borderType;
+        borderValue_ = borderValue;
+    }
+
+    /*************************************************
+     * void run(Mat inImg, int32_t height, int32_t width, Mat outImg)
+     * Mat inImg : 入力画像
+     * int32_t height : 高さ
+     * int32_t width : 横幅
+     * Mat outImg : 出力画像 (inImgと同じでもよい)
+     *
+     * 機能 : 融合した処理を1行ずつ実行する (各処理を順に実行した場合と同じ結果)
+     *        融合しない処理を含む場合はruntime()で1段ずつ実行する
+     *
+     * return : void
+     *************************************************/
+    void run(Mat inImg, int32_t height, int32_t width, Mat outImg) const
+    {
+        if constexpr (FUSED) {
+            typename detail::BuildLevels<detail::SourceLevel, Stages...>::type top;
+
+            top.init(inImg, height, width, borderType_, borderValue_, 0);
+            configure(top, std::index_sequence_for<Stages...>{});
+
+            for (int32_t y = 0; y < height; y++) {
+                top.compute(y, outImg.ptr<uint8_t>(y));
+            }
+        } else {
+            runtime().run(inImg, height, width, outImg);
+        }
+    }
+
+    // 各処理を1段ずつ実行するパイプライン (近傍の処理は1段だけの融合した処理として実行する)
+    RuntimePipeline runtime() const
+    {
+        RuntimePipeline runtime;
+        addSteps(runtime, std::index_sequence_for<Stages...>{});
+        return runtime;
+    }
+
+private:
+    template <class...>
+    friend class Pipeline;
+
+    // i番目の処理が属する段 (それまでの近傍の処理の数)
+    static constexpr int32_t levelOf(size_t i)
+    {
+        constexpr bool isPoint[] = {Stages::IS_POINT...};
+        int32_t        n         = 0;
+        for (size_t k = 0; k <= i; k++) {
+            n += isPoint[k] ? 0 : 1;
+        }
+        return n;
+    }
+
+    template <size_t... I>
+    void addSteps(RuntimePipeline &runtime, std::index_sequence<I...>) const
+    {
+        (runtime.add(step(std::get<I>(stages_))), ...);
+    }
+
+    template <class Fn>
+    RuntimePipeline::Step step(const Point<Fn> &stage) const
+    {
+        return [fn = stage.fn](Mat inImg, int32_t height, int32_t width, Mat outImg) {
+            pixelwise::ImageProcessor ips;
+            fn(ips, inImg, height, width, outImg);
+        };
+    }
+
+    RuntimePipeline::Step step(const Whole &stage) const
+    {
+        return [fn = stage.fn, borderType = borderType_, borderValue = borderValue_](Mat inImg, int32_t height,
+                                                                                     int32_t width, Mat outImg) {
+            filter::ImageProcessor ips2;
+            ips2.setBorder(borderType, borderValue);
+            fn(ips2, inImg, height, width, outImg);
+        };
+    }
+
+    template <class Stencil>
+    RuntimePipeline::Step step(const Stencil &stage) const
+    {
+        Pipeline<Stencil> single(std::make_tuple(stage));
+        single.setBorder(borderType_, borderValue_);
+        return [single](Mat inImg, int32_t height, int32_t width, Mat outImg) {
+            single.run(inImg, height, width, outImg);
+        };
+    }
+
+    template <class Top, size_t... I>
+    void configure(Top &top, std::index_sequence<I...>) const
+    {
+        (configureStage<I>(top), ...);
+    }
+
+    template <size_t I, class Top>
+    void configureStage(Top &top) const
+    {
+        using Stage  = std::tuple_element_t<I, std::tuple<Stages...>>;
+        auto &target = top.template level<levelOf(I)>();
+
+        if constexpr (Stage::IS_POINT) {
+            target.addPoint(std::get<I>(stages_).fn);
+        } else {
+            target.setStencil(std::get<I>(stages_));
+        }
+    }
+
+    std::tuple<Stages...> stages_;
+    BorderType            borderType_ = BorderType::Replicate;
+    Vec3b                 borderValue_;
+};
+
+// 画素値のみで決まる処理
+template <class Fn>
+Pipeline<Point<Fn>> point(Fn fn)
+{
+    return Pipeline<Point<Fn>>(std::make_tuple(Point<Fn>{fn}));
+}
+
+inline auto toneCurve(double coeff)
+{
+    return point([coeff](pixelwise::ImageProcessor &ips, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips.toneCurve(inImg, height, width, coeff, outImg);
+    });
+}
+
+inline auto linear(double a, double b)
+{
+    return point([a, b](pixelwise::ImageProcessor &ips, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips.effectLinear(inImg, height, width, a, b, outImg);
+    });
+}
+
+inline auto nega()
+{
+    return point([](pixelwise::ImageProcessor &ips, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips.effectNega(inImg, height, width, outImg);
+    });
+}
+
+inline auto gamma(double gammaVal)
+{
+    return point([gammaVal](pixelwise::ImageProcessor &ips, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips.effectGamma(inImg, height, width, gammaVal, outImg);
+    });
+}
+
+inline auto sigmoid(double k, double x0)
+{
+    return point([k, x0](pixelwise::ImageProcessor &ips, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips.effectSigmoid(inImg, height, width, k, x0, outImg);
+    });
+}
+
+// 近傍の処理
+template <int32_t KH, int32_t KW>
+Pipeline<Convolve<KH, KW>> convolve(const int32_t (&kernel)[KH][KW], double divisor, double bias)
+{
+    Convolve<KH, KW> stage{};
+    std::copy(&kernel[0][0], &kernel[0][0] + KH * KW, &stage.kernel[0][0]);
+    stage.divisor = divisor == 0.0 ? 1.0 : divisor;
+    stage.bias    = bias;
+    return Pipeline<Convolve<KH, KW>>(std::make_tuple(stage));
+}
+
+template <int32_t KH, int32_t KW>
+Pipeline<Gradient<KH, KW>> gradient(const int32_t (&kernelX)[KH][KW], const int32_t (&kernelY)[KH][KW])
+{
+    Gradient<KH, KW> stage{};
+    std::copy(&kernelX[0][0], &kernelX[0][0] + KH * KW, &stage.kernelX[0][0]);
+    std::copy(&kernelY[0][0], &kernelY[0][0] + KH * KW, &stage.kernelY[0][0]);
+    return Pipeline<Gradient<KH, KW>>(std::make_tuple(stage));
+}
+
+// 融合しない処理
+template <class Fn>
+Pipeline<Whole> whole(Fn fn)
+{
+    return Pipeline<Whole>(std::make_tuple(Whole{fn}));
+}
+
+inline auto equalization(int32_t filterCoeff)
+{
+    return whole([filterCoeff](filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips2.equalizationFilter(inImg, height, width, filterCoeff, outImg);
+    });
+}
+
+inline auto bilateral(double sigmaSpace, double sigmaRange)
+{
+    return whole([=](filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips2.bilateralFilter(inImg, height, width, sigmaSpace, sigmaRange, outImg);
+    });
+}
+
+inline auto erode(int32_t kernelW, int32_t kernelH)
+{
+    return whole([=](filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips2.erodeFilter(inImg, height, width, kernelW, kernelH, outImg);
+    });
+}
+
+inline auto dilate(int32_t kernelW, int32_t kernelH)
+{
+    return whole([=](filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips2.dilateFilter(inImg, height, width, kernelW, kernelH, outImg);
+    });
+}
+
+inline auto opening(int32_t kernelW, int32_t kernelH)
+{
+    return whole([=](filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips2.openingFilter(inImg, height, width, kernelW, kernelH, outImg);
+    });
+}
+
+inline auto closing(int32_t kernelW, int32_t kernelH)
+{
+    return whole([=](filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips2.closingFilter(inImg, height, width, kernelW, kernelH, outImg);
+    });
+}
+
+inline auto adaptiveThreshold(int32_t blockRadius, double k)
+{
+    return whole([=](filter::ImageProcessor &ips2, Mat inImg, int32_t height, int32_t width, Mat outImg) {
+        ips2.adaptiveThresholdFilter(inImg, height, width, blockRadius, k, outImg);
+    });
+}
+
+// filter::ImageProcessorの各フィルタと同じカーネル
+inline auto weightedAverage()
+{
+    const auto &filter = filter::WEIGHTED_AVERAGE_KERNEL;
+    return convolve(filter, std::accumulate(&filter[0][0], &filter[0][0] + 3 * 3, 0), 0);
+}
+
+inline auto sharpening()
+{
+    return convolve(filter::SHARPENING_KERNEL, 1, 0);
+}
+
+inline auto embossing()
+{
+    return convolve(filter::EMBOSSING_KERNEL, filter::EMBOSSING_DIVISOR, filter::EMBOSSING_BIAS);
+}
+
+inline auto edgeDetection()
+{
+    return gradient(filter::EDGE_DETECTION_KERNEL_X, filter::EDGE_DETECTION_KERNEL_Y);
+}
+
+inline auto sobel()
+{
+    return gradient(filter::SOBEL_KERNEL_X, filter::SOBEL_KERNEL_Y);
+}
+
+inline auto prewitt()
+{
+    return gradient(filter::PREWITT_KERNEL_X, filter::PREWITT_KERNEL_Y);
+}
+
+inline auto roberts()
+{
+    return gradient(filter::ROBERTS_KERNEL_X, filter::ROBERTS_KERNEL_Y);
+}
+
+inline auto median()
+{
+    return Pipeline<Median>(std::make_tuple(Median{}));
+}
+
+}  // namespace pipeline
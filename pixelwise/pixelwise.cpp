@@ -1,14 +1,58 @@
 #include "pixelwise.h"
 #include "../param.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 
 namespace pixelwise {
+
+namespace {
+// BGR <-> YCrCb (BT.601) の固定小数点係数 (14ビット)
+constexpr int32_t YCC_SHIFT = 14;
+constexpr int32_t YCC_ROUND = 1 << (YCC_SHIFT - 1);
+constexpr int32_t Y_R       = 4899;    // 0.299
+constexpr int32_t Y_G       = 9617;    // 0.587
+constexpr int32_t Y_B       = 1868;    // 0.114
+constexpr int32_t CR_COEF   = 11682;   // 0.713
+constexpr int32_t CB_COEF   = 9241;    // 0.564
+constexpr int32_t R_CR      = 22987;   // 1.403
+constexpr int32_t G_CR      = -11698;  // -0.714
+constexpr int32_t G_CB      = -5636;   // -0.344
+constexpr int32_t B_CB      = 29049;   // 1.773
+
+constexpr int32_t SWEEP_TILE_BYTES = 32 * 1024;  // パラメータスイープで1度に読む入力の大きさ (L1/L2に収まる程度)
+constexpr size_t  MAX_LUTS         = 64;         // 保持するLUTの数 (超えた場合はすべて破棄して作り直す)
+
+// BGRの画素から輝度Yを求める
+inline int32_t lumaOf(const uint8_t *pix)
+{
+    return (pix[RED] * Y_R + pix[GREEN] * Y_G + pix[BLUE] * Y_B + YCC_ROUND) >> YCC_SHIFT;
+}
+
+// 固定小数点の積を丸めて整数に戻す (負の値も四捨五入)
+inline int32_t descale(int32_t v)
+{
+    return (v + YCC_ROUND) >> YCC_SHIFT;
+}
+
+// LUTのキー (NaNも区別できるようにビット列で比較する)
+inline uint64_t paramBits(double param)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &param, sizeof(bits));
+    return bits;
+}
+}  // namespace
+
 /*************************************************
  * void toneCurve(Mat inImg, int32_t height, int32_t width, double coeff, Mat outImg)
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
  * double coeff : 係数
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : トーンカーブ処理
  *
@@ -16,20 +60,7 @@ namespace pixelwise {
  *************************************************/
 void ImageProcessor::toneCurve(Mat inImg, int32_t height, int32_t width, double coeff, Mat outImg)
 {
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            // 画素値を取得
-            Vec3b &pix = inImg.at<Vec3b>(y, x);
-
-            // 画素値を係数倍して範囲を0-255に収める
-            uint8_t blue  = static_cast<uint8_t>(std::min(255.0, std::max(0.0, pix[BLUE] * coeff)));
-            uint8_t green = static_cast<uint8_t>(std::min(255.0, std::max(0.0, pix[GREEN] * coeff)));
-            uint8_t red   = static_cast<uint8_t>(std::min(255.0, std::max(0.0, pix[RED] * coeff)));
-
-            // 画素値を設定
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
-        }
-    }
+    applyLut(inImg, height, width, pointLut(IpsType::ToneCurve, coeff, 0.0), outImg);
 }
 
 /*************************************************
@@ -39,7 +70,7 @@ void ImageProcessor::toneCurve(Mat inImg, int32_t height, int32_t width, double
  * int32_t width : 横幅
  * double a : 係数a(コントラスト)
  * double b : 係数b(明るさ)
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : 線形変換
  *
@@ -47,20 +78,7 @@ void ImageProcessor::toneCurve(Mat inImg, int32_t height, int32_t width, double
  *************************************************/
 void ImageProcessor::effectLinear(Mat inImg, int32_t height, int32_t width, double a, double b, Mat outImg)
 {
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            // 画素値を取得
-            Vec3b &pix = inImg.at<Vec3b>(y, x);
-
-            // 画素値を線形変換して範囲を0-255に収める
-            uint8_t blue  = static_cast<uint8_t>(std::min(255.0, std::max(0.0, a * pix[BLUE] + b)));
-            uint8_t green = static_cast<uint8_t>(std::min(255.0, std::max(0.0, a * pix[GREEN] + b)));
-            uint8_t red   = static_cast<uint8_t>(std::min(255.0, std::max(0.0, a * pix[RED] + b)));
-
-            // 画素値を設定
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
-        }
-    }
+    applyLut(inImg, height, width, pointLut(IpsType::Linear, a, b), outImg);
 }
 
 /*************************************************
@@ -68,7 +86,7 @@ void ImageProcessor::effectLinear(Mat inImg, int32_t height, int32_t width, doub
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : ネガ処理
  *
@@ -98,7 +116,7 @@ void ImageProcessor::effectNega(Mat inImg, int32_t height, int32_t width, Mat ou
  * int32_t height : 高さ
  * int32_t width : 横幅
  * double gammaVal : ガンマ値
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : ガンマ変換
  *
@@ -106,30 +124,7 @@ void ImageProcessor::effectNega(Mat inImg, int32_t height, int32_t width, Mat ou
  *************************************************/
 void ImageProcessor::effectGamma(Mat inImg, int32_t height, int32_t width, double gammaVal, Mat outImg)
 {
-    uint8_t LUT[256];  // Look Up Table
-
-    // LUTを作成
-    for (int32_t i = 0; i < 256; i++) {
-        // 0~1に正規化
-        double tmp = i / 255.0;
-        // ガンマ変換
-        LUT[i] = static_cast<uint8_t>(std::pow(tmp, gammaVal) * 255.0);
-    }
-
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            // 画素値を取得
-            Vec3b &pix = inImg.at<Vec3b>(y, x);
-
-            // 画素値をガンマ変換して範囲を0-255に収める
-            uint8_t blue  = LUT[pix[BLUE]];
-            uint8_t green = LUT[pix[GREEN]];
-            uint8_t red   = LUT[pix[RED]];
-
-            // 画素値を設定
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
-        }
-    }
+    applyLut(inImg, height, width, pointLut(IpsType::Gamma, gammaVal, 0.0), outImg);
 }
 
 /*************************************************
@@ -139,7 +134,7 @@ void ImageProcessor::effectGamma(Mat inImg, int32_t height, int32_t width, doubl
  * int32_t width : 横幅
  * double k : 傾き
  * double x0 : 変化の中心点
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : シグモイド関数
  *
@@ -147,30 +142,7 @@ void ImageProcessor::effectGamma(Mat inImg, int32_t height, int32_t width, doubl
  *************************************************/
 void ImageProcessor::effectSigmoid(Mat inImg, int32_t height, int32_t width, double k, double x0, Mat outImg)
 {
-    uint8_t LUT[256];  // Look Up Table
-
-    // LUTを作成
-    for (int32_t i = 0; i < 256; i++) {
-        // 0~1に正規化
-        double norm = i / 255.0;
-        // シグモイド関数を適用
-        LUT[i] = static_cast<uint8_t>((1.0 / (1.0 + std::exp(-k * (norm - x0)))) * 255.0);
-    }
-
-    for (int32_t y = 0; y < height; y++) {
-        for (int32_t x = 0; x < width; x++) {
-            // 画素値を取得
-            Vec3b &pix = inImg.at<Vec3b>(y, x);
-
-            // 画素値をシグモイド関数で変換して範囲を0-255に収める
-            uint8_t blue  = LUT[pix[BLUE]];
-            uint8_t green = LUT[pix[GREEN]];
-            uint8_t red   = LUT[pix[RED]];
-
-            // 画素値を設定
-            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
-        }
-    }
+    applyLut(inImg, height, width, pointLut(IpsType::Sigmoid, k, x0), outImg);
 }
 
 /*************************************************
@@ -212,7 +184,7 @@ void ImageProcessor::calcNormHist(Mat inImg, int32_t height, int32_t width, floa
  * Mat inImg : 入力画像
  * int32_t height : 高さ
  * int32_t width : 横幅
- * Mat outImg : 出力画像
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
  *
  * 機能 : ヒストグラム均等化
  *
@@ -256,4 +228,216 @@ void ImageProcessor::histEqualization(Mat inImg, int32_t height, int32_t width,
         }
     }
 }
+
+/*************************************************
+ * void histEqualizationLuma(Mat inImg, int32_t height, int32_t width, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 輝度のみのヒストグラム均等化 (色相を保つ)
+ *        1回目の走査でBGRから整数演算で求めた輝度Yのヒストグラムを作成し、
+ *        2回目の走査で画素ごとにYCrCbへの変換、Yの変換、BGRへの逆変換をまとめて行う
+ *        (YCrCbの画像は作らない)
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::histEqualizationLuma(Mat inImg, int32_t height, int32_t width, Mat outImg)
+{
+    int64_t histTmp[256] = {0};
+    int64_t total        = static_cast<int64_t>(height) * width;
+    uint8_t histEq[256];
+
+    // 輝度のヒストグラムの作成
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t *src = inImg.ptr<uint8_t>(y);
+        for (int32_t x = 0; x < width; x++) {
+            histTmp[lumaOf(src + x * 3)]++;
+        }
+    }
+
+    // 累積分布関数を計算(0~255の範囲に正規化)
+    int64_t cum = 0;
+    for (int32_t i = 0; i < 256; i++) {
+        cum += histTmp[i];
+        histEq[i] = static_cast<uint8_t>(total > 0 ? (255 * cum + total / 2) / total : i);
+    }
+
+    // 輝度のみヒストグラム均等化 (色差はそのまま)
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t *src = inImg.ptr<uint8_t>(y);
+        uint8_t       *dst = outImg.ptr<uint8_t>(y);
+
+        for (int32_t x = 0; x < width * 3; x += 3) {
+            // BGR -> YCrCb (色差は128を引いた値、8ビットに収める)
+            int32_t luma = lumaOf(src + x);
+            int32_t cr   = std::clamp(descale((src[x + RED] - luma) * CR_COEF), -128, 127);
+            int32_t cb   = std::clamp(descale((src[x + BLUE] - luma) * CB_COEF), -128, 127);
+
+            // Yの変換、YCrCb -> BGR
+            int32_t lumaEq = histEq[luma];
+            dst[x + BLUE]  = static_cast<uint8_t>(std::clamp(lumaEq + descale(cb * B_CB), 0, 255));
+            dst[x + GREEN] = static_cast<uint8_t>(std::clamp(lumaEq + descale(cr * G_CR + cb * G_CB), 0, 255));
+            dst[x + RED]   = static_cast<uint8_t>(std::clamp(lumaEq + descale(cr * R_CR), 0, 255));
+        }
+    }
+}
+
+/*************************************************
+ * void paramSweep(Mat inImg, int32_t height, int32_t width, IpsType ipsType, const std::vector<double> &values1,
+ *                 const std::vector<double> &values2, std::vector<Mat> &outImgs)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * IpsType ipsType : 濃淡処理の種類 (ToneCurve, Linear, Nega, Gamma, Sigmoid)
+ * const std::vector<double> &values1 : 1つ目のパラメータの値 (coeff, a, gammaVal, k)
+ * const std::vector<double> &values2 : 2つ目のパラメータの値 (b, x0、1つ目のみの処理では使わない)
+ * std::vector<Mat> &outImgs : 出力画像 (values1 x values2の組み合わせの順、values1が外側)
+ *
+ * 機能 : パラメータの組み合わせごとの濃淡処理をまとめて行う
+ *        組み合わせごとのLUTを先にpointLutで取得し (作成済みのLUTは作り直さない)、
+ *        入力画像の行をキャッシュに収まる帯ごとに読んですべてのLUTを適用するため、入力画像は1回しか読まない
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::paramSweep(Mat inImg, int32_t height, int32_t width, IpsType ipsType,
+                                const std::vector<double> &values1, const std::vector<double> &values2,
+                                std::vector<Mat> &outImgs)
+{
+    if (ipsType != IpsType::ToneCurve && ipsType != IpsType::Linear && ipsType != IpsType::Nega &&
+        ipsType != IpsType::Gamma && ipsType != IpsType::Sigmoid) {
+        // 画素値のみで決まらない処理は対象外
+        outImgs.clear();
+        return;
+    }
+
+    bool                twoParams = ipsType == IpsType::Linear || ipsType == IpsType::Sigmoid;
+    std::vector<double> firsts    = ipsType == IpsType::Nega ? std::vector<double>{0.0} : values1;
+    std::vector<double> seconds   = twoParams ? values2 : std::vector<double>{0.0};
+
+    // 組み合わせごとのLUTを取得 (pointLutが返すLUTは次の作成で破棄される場合があるため写しを持つ)
+    std::vector<std::array<uint8_t, 256>> luts;
+    for (double v1 : firsts) {
+        for (double v2 : seconds) {
+            const uint8_t           *src = pointLut(ipsType, v1, twoParams ? v2 : 0.0);
+            std::array<uint8_t, 256> lut;
+            std::copy(src, src + 256, lut.begin());
+            luts.push_back(lut);
+        }
+    }
+
+    outImgs.resize(luts.size());
+    for (Mat &outImg : outImgs) {
+        if (outImg.rows != height || outImg.cols != width || outImg.type() != CV_8UC3) {
+            outImg = Mat{height, width, CV_8UC3};
+        }
+    }
+
+    // 入力画像の帯ごとにすべてのLUTを適用
+    int32_t tileRows = std::max(1, SWEEP_TILE_BYTES / std::max(width * 3, 1));
+    for (int32_t y0 = 0; y0 < height; y0 += tileRows) {
+        int32_t y1 = std::min(y0 + tileRows, height);
+
+        for (size_t n = 0; n < luts.size(); n++) {
+            const uint8_t *lut = luts[n].data();
+            for (int32_t y = y0; y < y1; y++) {
+                const uint8_t *src = inImg.ptr<uint8_t>(y);
+                uint8_t       *dst = outImgs[n].ptr<uint8_t>(y);
+
+                for (int32_t i = 0; i < width * 3; i++) {
+                    // LUTはB, G, Rに共通
+                    dst[i] = lut[src[i]];
+                }
+            }
+        }
+    }
+}
+
+/*************************************************
+ * const uint8_t *pointLut(IpsType ipsType, double param1, double param2)
+ * IpsType ipsType : 濃淡処理の種類 (ToneCurve, Linear, Nega, Gamma, Sigmoid)
+ * double param1 : 1つ目のパラメータ (coeff, a, gammaVal, k)
+ * double param2 : 2つ目のパラメータ (b, x0、1つ目のみの処理では使わない)
+ *
+ * 機能 : 画素値ごとの変換結果のLUTを取得 (同じ処理とパラメータのLUTは作成済みのものを使う)
+ *
+ * return : const uint8_t * 256要素のLUT (次にLUTを作成するまで有効)
+ *************************************************/
+const uint8_t *ImageProcessor::pointLut(IpsType ipsType, double param1, double param2)
+{
+    auto key = std::make_tuple(ipsType, paramBits(param1), paramBits(param2));
+    auto it  = luts_.find(key);
+    if (it != luts_.end()) {
+        return it->second.data();
+    }
+
+    if (luts_.size() >= MAX_LUTS) {
+        luts_.clear();
+    }
+    std::array<uint8_t, 256> &LUT = luts_[key];  // Look Up Table
+
+    // LUTを作成
+    for (int32_t i = 0; i < 256; i++) {
+        // 0~1に正規化
+        double norm = i / 255.0;
+
+        switch (ipsType) {
+        case IpsType::ToneCurve:
+            // 画素値を係数倍して範囲を0-255に収める
+            LUT[i] = static_cast<uint8_t>(std::min(255.0, std::max(0.0, i * param1)));
+            break;
+        case IpsType::Linear:
+            // 画素値を線形変換して範囲を0-255に収める
+            LUT[i] = static_cast<uint8_t>(std::min(255.0, std::max(0.0, param1 * i + param2)));
+            break;
+        case IpsType::Nega:
+            // 画素値を反転
+            LUT[i] = static_cast<uint8_t>(255 - i);
+            break;
+        case IpsType::Gamma:
+            // ガンマ変換
+            LUT[i] = static_cast<uint8_t>(std::pow(norm, param1) * 255.0);
+            break;
+        case IpsType::Sigmoid:
+            // シグモイド関数を適用
+            LUT[i] = static_cast<uint8_t>((1.0 / (1.0 + std::exp(-param1 * (norm - param2)))) * 255.0);
+            break;
+        default:
+            LUT[i] = static_cast<uint8_t>(i);
+            break;
+        }
+    }
+    return LUT.data();
+}
+
+/*************************************************
+ * void applyLut(Mat inImg, int32_t height, int32_t width, const uint8_t *lut, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * const uint8_t *lut : 256要素のLUT (B, G, Rに共通)
+ * Mat outImg : 出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 画素値をLUTで変換
+ *
+ * return : void
+ *************************************************/
+void ImageProcessor::applyLut(Mat inImg, int32_t height, int32_t width, const uint8_t *lut, Mat outImg)
+{
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            // 画素値を取得
+            Vec3b &pix = inImg.at<Vec3b>(y, x);
+
+            // 画素値をLUTで変換
+            uint8_t blue  = lut[pix[BLUE]];
+            uint8_t green = lut[pix[GREEN]];
+            uint8_t red   = lut[pix[RED]];
+
+            // 画素値を設定
+            outImg.at<Vec3b>(y, x) = Vec3b(blue, green, red);
+        }
+    }
+}
 }  // namespace pixelwise
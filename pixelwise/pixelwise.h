@@ -1,6 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <map>
 #include <opencv2/opencv.hpp>
+#include <tuple>
+#include <vector>
 
 using namespace cv;
 
@@ -8,15 +13,17 @@ namespace pixelwise {
 
 enum class IpsType
 {
-    ToneCurve        = 0,
-    Linear           = 1,
-    Nega             = 2,
-    Gamma            = 3,
-    Sigmoid          = 4,
-    HistEqualization = 5,
-    None             = 99
+    ToneCurve            = 0,
+    Linear               = 1,
+    Nega                 = 2,
+    Gamma                = 3,
+    Sigmoid              = 4,
+    HistEqualization     = 5,
+    HistEqualizationLuma = 6,
+    None                 = 99
 };
 
+// 作成したLUTを保持するため、1つのインスタンスを複数のスレッドから同時に使わないこと
 class ImageProcessor
 {
 public:
@@ -27,6 +34,16 @@ public:
     void effectSigmoid(Mat inImg, int32_t height, int32_t width, double k, double x0, Mat outImg);
     void calcNormHist(Mat inImg, int32_t height, int32_t width, float *hist);
     void histEqualization(Mat inImg, int32_t height, int32_t width, Mat outImg);
+    void histEqualizationLuma(Mat inImg, int32_t height, int32_t width, Mat outImg);
+    void paramSweep(Mat inImg, int32_t height, int32_t width, IpsType ipsType, const std::vector<double> &values1,
+                    const std::vector<double> &values2, std::vector<Mat> &outImgs);
+
+private:
+    const uint8_t *pointLut(IpsType ipsType, double param1, double param2);
+    void           applyLut(Mat inImg, int32_t height, int32_t width, const uint8_t *lut, Mat outImg);
+
+    // 処理とパラメータ(のビット列)ごとのLUT (同じインスタンスで同じ処理を繰り返す場合は作り直さない)
+    std::map<std::tuple<IpsType, uint64_t, uint64_t>, std::array<uint8_t, 256>> luts_;
 };
 
 }  // namespace pixelwise
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "preview.h"
+#include "../roi/roi.h"
+#include "../server/server.h"
+
+namespace preview {
+
+namespace {
+constexpr int32_t BAND_ROWS = 64;  // 中止を確かめる間隔 (行)
+
+// 縮小画像に合わせて要求のパラメータを調整する (paramsの意味はserver::processFrameと同じ)
+server::Request scaleRequest(const server::Request &request, double scale)
+{
+    server::Request scaled = request;
+    double         *p      = scaled.params;
+    if (request.module != server::Module::Filter) {
+        return scaled;
+    }
+
+    switch (static_cast<filter::IpsType>(request.ipsType)) {
+    case filter::IpsType::EqualizationFilter:
+    case filter::IpsType::BoxFilter:
+    case filter::IpsType::AdaptiveThreshold:
+        p[0] = scaleRadius(static_cast<int32_t>(p[0]), scale);
+        break;
+    case filter::IpsType::BilateralFilter:
+        p[0] = scaleSigma(p[0], scale);
+        break;
+    case filter::IpsType::ErodeFilter:
+    case filter::IpsType::DilateFilter:
+    case filter::IpsType::OpeningFilter:
+    case filter::IpsType::ClosingFilter:
+        p[0] = scaleKernelSize(static_cast<int32_t>(p[0]), scale);
+        p[1] = scaleKernelSize(static_cast<int32_t>(p[1]), scale);
+        break;
+    default:
+        // 3x3の固定のカーネルはそのまま
+        break;
+    }
+    return scaled;
+}
+
+// 要求の処理の参照範囲
+Size radiusOf(const server::Request &request)
+{
+    if (request.module == server::Module::Pixelwise) {
+        return roi::pixelwiseRadius(static_cast<pixelwise::IpsType>(request.ipsType));
+    }
+    int32_t i0 = static_cast<int32_t>(request.params[0]);
+    int32_t i1 = static_cast<int32_t>(request.params[1]);
+    return roi::filterRadius(static_cast<filter::IpsType>(request.ipsType), i0, i1);
+}
+}  // namespace
+
+/*************************************************
+ * Op requestOp(const server::Request &request, pixelwise::ImageProcessor &ips, filter::ImageProcessor &ips2)
+ * const Request &request : 処理の指定 (module, ipsType, params, borderType, borderValueを使う)
+ * pixelwise::ImageProcessor &ips : 濃淡処理 (Opを使い終わるまで他から使わないこと)
+ * filter::ImageProcessor &ips2 : フィルタ処理 (Opを使い終わるまで他から使わないこと)
+ *
+ * 機能 : 要求の処理を行うOpを作成
+ *        各レベルでは近傍の大きさのパラメータを縮小率に合わせて調整し、行の帯ごとに処理して帯の間で中止を確かめる
+ *        画像全体を参照する処理と、端の処理がWrapの場合は帯に分けずに1回で処理する
+ *        対応していない処理やパラメータが範囲外の場合は入力画像をそのまま出力する
+ *
+ * return : Op 処理
+ *************************************************/
+Op requestOp(const server::Request &request, pixelwise::ImageProcessor &ips, filter::ImageProcessor &ips2)
+{
+    return [request, &ips, &ips2](Mat inImg, int32_t height, int32_t width, double scale,
+                                  const IsCancelled &isCancelled, Mat outImg) {
+        // 範囲は等倍の画像の大きさで確かめる
+        server::Request checked = request;
+        checked.height          = static_cast<int32_t>(std::lround(height / scale));
+        checked.width           = static_cast<int32_t>(std::lround(width / scale));
+        if (!server::validParams(checked)) {
+            inImg.copyTo(outImg);
+            return;
+        }
+
+        server::Request scaled = scaleRequest(request, scale);
+        roi::Op         bandOp = [&](Mat bandIn, int32_t bandHeight, int32_t bandWidth, Rect, Mat bandOut) {
+            scaled.height = bandHeight;
+            scaled.width  = bandWidth;
+            if (server::processFrame(scaled, bandIn, bandOut, ips, ips2) != server::Status::Ok) {
+                bandIn.copyTo(bandOut);
+            }
+        };
+
+        Size       radius     = radiusOf(scaled);
+        BorderType borderType = static_cast<BorderType>(scaled.borderType);
+        if (radius == roi::FULL_FRAME || (scaled.module == server::Module::Filter && borderType == BorderType::Wrap)) {
+            bandOp(inImg, height, width, Rect(0, 0, width, height), outImg);
+            return;
+        }
+
+        for (int32_t y0 = 0; y0 < height; y0 += BAND_ROWS) {
+            if (isCancelled()) {
+                return;
+            }
+            Rect band(0, y0, width, std::min(BAND_ROWS, height - y0));
+            roi::processRegions(inImg, height, width, {band}, radius, borderType, bandOp, outImg);
+        }
+    };
+}
+
+ProgressivePreview::~ProgressivePreview()
+{
+    cancel();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+/*************************************************
+ * void setImage(Mat img, int32_t height, int32_t width)
+ * Mat img : 入力画像 (処理中は変更しない)
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ *
+ * 機能 : 実行中の処理を中止し、入力画像の画像ピラミッドを作成
+ *        パラメータを変えて何度処理しても、ピラミッドは作り直さない
+ *        処理スレッドは古いピラミッドを参照したまま中止するため、終了を待たない
+ *
+ * return : void
+ *************************************************/
+void ProgressivePreview::setImage(Mat img, int32_t height, int32_t width)
+{
+    cancel();
+
+    auto pyramid = std::make_shared<std::vector<Mat>>(LEVELS);
+    (*pyramid)[0] = img(Rect(0, 0, width, height));
+    for (int32_t level = 1; level < LEVELS; level++) {
+        pyrDown((*pyramid)[level - 1], (*pyramid)[level]);
+    }
+    pyramid_ = std::move(pyramid);
+}
+
+/*************************************************
+ * bool run(const Op &op, const Callback &onResult)
+ * const Op &op : 各レベルの画像に行う処理
+ * const Callback &onResult : 各レベルの結果を受け取る関数
+ *
+ * 機能 : 粗いレベルから順に処理し、結果をonResultに渡す (呼び出したスレッドで実行)
+ *        別のスレッドからcancelされた場合は次のレベルに進まない
+ *
+ * return : bool 等倍まで処理した場合はtrue
+ *************************************************/
+bool ProgressivePreview::run(const Op &op, const Callback &onResult)
+{
+    return refine(generation_.load(), pyramid_, op, onResult);
+}
+
+/*************************************************
+ * void start(Op op, Callback onResult)
+ * Op op : 各レベルの画像に行う処理
+ * Callback onResult : 各レベルの結果を受け取る関数 (処理スレッドから呼ばれる)
+ *
+ * 機能 : 実行中の処理を中止し、処理スレッドに段階的な処理を依頼
+ *        処理スレッドの終了は待たずに戻るため、UIスレッドからパラメータを変えるたびに呼べる
+ *        古いパラメータの処理はopのisCancelledで中止され、未処理の依頼は最新のものに置き換わる
+ *
+ * return : void
+ *************************************************/
+void ProgressivePreview::start(Op op, Callback onResult)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t                    generation = ++generation_;
+        pending_ = Job{generation, pyramid_, std::move(op), std::move(onResult)};
+        if (!worker_.joinable()) {
+            worker_ = std::thread(&ProgressivePreview::workerLoop, this);
+        }
+    }
+    cv_.notify_all();
+}
+
+/*************************************************
+ * void cancel()
+ *
+ * 機能 : 実行中の処理を中止 (opがisCancelledを確かめた時点で戻り、その結果は渡さない)
+ *
+ * return : void
+ *************************************************/
+void ProgressivePreview::cancel()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    pending_.reset();
+}
+
+/*************************************************
+ * void wait()
+ *
+ * 機能 : 依頼した処理がすべて終わるまで待つ (処理スレッドは終了しない)
+ *
+ * return : void
+ *************************************************/
+void ProgressivePreview::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !pending_ && !busy_; });
+}
+
+// 処理スレッド (最新の依頼を取り出して処理する)
+void ProgressivePreview::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stopping_ || pending_; });
+        if (stopping_) {
+            return;
+        }
+
+        Job job = std::move(*pending_);
+        pending_.reset();
+        busy_ = true;
+        lock.unlock();
+
+        refine(job.generation, job.pyramid, job.op, job.onResult);
+
+        lock.lock();
+        busy_ = false;
+        cv_.notify_all();
+    }
+}
+
+// 粗いレベルから順に処理 (世代が変わったら中止)
+bool ProgressivePreview::refine(uint64_t generation, const Pyramid &pyramid, const Op &op, const Callback &onResult)
+{
+    if (!pyramid) {
+        return false;
+    }
+
+    IsCancelled isCancelled = [this, generation] { return generation_.load() != generation; };
+    for (int32_t level = static_cast<int32_t>(pyramid->size()) - 1; level >= 0; level--) {
+        if (isCancelled()) {
+            return false;
+        }
+
+        Mat    inImg  = (*pyramid)[level];
+        Mat    outImg = Mat{inImg.rows, inImg.cols, CV_8UC3};
+        double scale  = 1.0 / (1 << level);
+        op(inImg, inImg.rows, inImg.cols, scale, isCancelled, outImg);
+
+        if (isCancelled()) {
+            return false;
+        }
+        onResult(outImg, level, scale);
+    }
+    return true;
+}
+
+}  // namespace preview
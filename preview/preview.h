@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../filter/filter.h"
+#include "../pixelwise/pixelwise.h"
+#include "../server/protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace cv;
+
+namespace preview {
+
+// 縮小画像での近傍の半径 (scale倍して丸める、0より大きい半径は1以上)
+inline int32_t scaleRadius(int32_t radius, double scale)
+{
+    return radius > 0 ? std::max(1, static_cast<int32_t>(std::lround(radius * scale))) : 0;
+}
+
+// 縮小画像での構造要素やカーネルの大きさ (中心を保つため奇数は奇数のまま)
+inline int32_t scaleKernelSize(int32_t size, double scale)
+{
+    return size % 2 == 1 ? 2 * scaleRadius(size / 2, scale) + 1 : std::max(1, static_cast<int32_t>(size * scale));
+}
+
+// 縮小画像での空間方向の標準偏差
+inline double scaleSigma(double sigma, double scale)
+{
+    return std::max(sigma * scale, 0.5);
+}
+
+// 処理を中止すべきかを返す (処理中に繰り返し呼んで、trueなら途中で戻ってよい)
+using IsCancelled = std::function<bool()>;
+
+// op(inImg, height, width, scale, isCancelled, outImg) : scaleは等倍に対する縮小率 (近傍の大きさの調整に使う)
+using Op = std::function<void(Mat inImg, int32_t height, int32_t width, double scale, const IsCancelled &isCancelled,
+                              Mat outImg)>;
+
+Op requestOp(const server::Request &request, pixelwise::ImageProcessor &ips, filter::ImageProcessor &ips2);
+
+// 画像ピラミッドによる段階的なプレビュー (1/8 -> 1/4 -> 1/2 -> 等倍の順に結果を返す)
+// start()は呼び出したスレッドを待たせず、処理スレッドは最新の要求だけを処理する
+class ProgressivePreview
+{
+public:
+    static constexpr int32_t LEVELS = 4;  // 等倍、1/2、1/4、1/8
+
+    // onResult(outImg, level, scale) : levelは0が等倍
+    using Callback = std::function<void(Mat outImg, int32_t level, double scale)>;
+
+    ~ProgressivePreview();
+
+    void setImage(Mat img, int32_t height, int32_t width);
+    bool run(const Op &op, const Callback &onResult);
+    void start(Op op, Callback onResult);
+    void cancel();
+    void wait();
+
+private:
+    using Pyramid = std::shared_ptr<const std::vector<Mat>>;  // 添字がレベル (0が等倍)
+
+    // 処理スレッドに渡す要求 (世代が変わっていれば処理しない)
+    struct Job
+    {
+        uint64_t generation;
+        Pyramid  pyramid;
+        Op       op;
+        Callback onResult;
+    };
+
+    bool refine(uint64_t generation, const Pyramid &pyramid, const Op &op, const Callback &onResult);
+    void workerLoop();
+
+    Pyramid               pyramid_;
+    std::atomic<uint64_t> generation_{0};
+
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    std::optional<Job>      pending_;           // 未処理の最新の要求
+    bool                    busy_     = false;  // 処理スレッドが要求を処理中
+    bool                    stopping_ = false;
+    std::thread             worker_;
+};
+
+}  // namespace preview
@@ -0,0 +1,237 @@
+#include "roi.h"
+#include <algorithm>
+
+namespace roi {
+
+namespace {
+// 矩形を上下左右に広げて画像内に収める
+Rect expandRect(Rect rect, Size radius, int32_t height, int32_t width)
+{
+    Rect expanded(rect.x - radius.width, rect.y - radius.height, rect.width + 2 * radius.width,
+                  rect.height + 2 * radius.height);
+    return expanded & Rect(0, 0, width, height);
+}
+}  // namespace
+
+/*************************************************
+ * Size pixelwiseRadius(pixelwise::IpsType ipsType)
+ * pixelwise::IpsType ipsType : 濃淡処理の種類
+ *
+ * 機能 : 濃淡処理の参照範囲を取得
+ *
+ * return : Size 参照範囲 (横、縦の半径、画像全体を参照する処理はFULL_FRAME)
+ *************************************************/
+Size pixelwiseRadius(pixelwise::IpsType ipsType)
+{
+    switch (ipsType) {
+    case pixelwise::IpsType::HistEqualization:
+    case pixelwise::IpsType::HistEqualizationLuma:
+        // ヒストグラムは画像全体から求める
+        return FULL_FRAME;
+    default:
+        return Size(0, 0);
+    }
+}
+
+/*************************************************
+ * Size filterRadius(filter::IpsType ipsType, int32_t param1, int32_t param2)
+ * filter::IpsType ipsType : フィルタ処理の種類
+ * int32_t param1 : 処理の大きさのパラメータ
+ *                  (EqualizationFilter : filterCoeff, 収縮・膨張・オープニング・クロージング : kernelW,
+ *                   BoxFilter : radiusMapの最大値, AdaptiveThreshold : blockRadius, Convolution : kernel.cols)
+ * int32_t param2 : 処理の大きさのパラメータ (収縮・膨張・オープニング・クロージング : kernelH,
+ *                  Convolution : kernel.rows)
+ *
+ * 機能 : フィルタ処理の参照範囲を取得
+ *
+ * return : Size 参照範囲 (横、縦の半径、画像全体を参照する処理はFULL_FRAME)
+ *************************************************/
+Size filterRadius(filter::IpsType ipsType, int32_t param1, int32_t param2)
+{
+    switch (ipsType) {
+    case filter::IpsType::EqualizationFilter:
+    case filter::IpsType::BoxFilter:
+    case filter::IpsType::AdaptiveThreshold:
+        return Size(param1, param1);
+    case filter::IpsType::WeightedAverage:
+    case filter::IpsType::SharpeningFilter:
+    case filter::IpsType::EdgeDetectionFilter:
+    case filter::IpsType::SobelFilter:
+    case filter::IpsType::PrewittFilter:
+    case filter::IpsType::RobertsFilter:
+    case filter::IpsType::EmbossingFilter:
+    case filter::IpsType::MedianFilter:
+        return Size(1, 1);
+    case filter::IpsType::ErodeFilter:
+    case filter::IpsType::DilateFilter:
+    case filter::IpsType::Convolution:
+        return Size(param1 / 2, param2 / 2);
+    case filter::IpsType::OpeningFilter:
+    case filter::IpsType::ClosingFilter:
+        // 収縮と膨張の2回分
+        return Size(param1 / 2 * 2, param2 / 2 * 2);
+    case filter::IpsType::BilateralFilter:
+        // グリッドの位置が画像の原点で決まるため、部分画像では同じ結果にならない
+        return FULL_FRAME;
+    default:
+        return Size(0, 0);
+    }
+}
+
+/*************************************************
+ * Size chainRadius(const std::vector<Size> &radii)
+ * const std::vector<Size> &radii : 順に行う処理の参照範囲
+ *
+ * 機能 : 処理を順に行った場合の参照範囲を取得
+ *
+ * return : Size 参照範囲の和 (いずれかがFULL_FRAMEならFULL_FRAME)
+ *************************************************/
+Size chainRadius(const std::vector<Size> &radii)
+{
+    Size total(0, 0);
+    for (const Size &radius : radii) {
+        if (radius == FULL_FRAME) {
+            return FULL_FRAME;
+        }
+        total += radius;
+    }
+    return total;
+}
+
+/*************************************************
+ * std::vector<Rect> affectedRects(const std::vector<Rect> &dirtyRects, int32_t height, int32_t width, Size radius,
+ *                                 BorderType borderType)
+ * const std::vector<Rect> &dirtyRects : 入力画像の変更された矩形
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Size radius : 処理の参照範囲
+ * BorderType borderType : 処理で使う画像の端の処理
+ *
+ * 機能 : 出力画像で再計算が必要な矩形を求める
+ *        変更された矩形を参照範囲だけ広げ、重なる矩形は外接矩形の方が小さくなる場合にまとめる
+ *        (Wrapで画像の端の近くが変更された場合は反対側の端にも影響するため画像全体)
+ *
+ * return : std::vector<Rect> 出力画像の再計算が必要な矩形
+ *************************************************/
+std::vector<Rect> affectedRects(const std::vector<Rect> &dirtyRects, int32_t height, int32_t width, Size radius,
+                                BorderType borderType)
+{
+    std::vector<Rect> rects;
+    Rect              frame(0, 0, width, height);
+
+    bool wrapsAround = false;
+    if (borderType == BorderType::Wrap && radius != FULL_FRAME) {
+        for (const Rect &dirty : dirtyRects) {
+            Rect expanded(dirty.x - radius.width, dirty.y - radius.height, dirty.width + 2 * radius.width,
+                          dirty.height + 2 * radius.height);
+            wrapsAround = wrapsAround || (expanded & frame) != expanded;
+        }
+    }
+
+    if (radius == FULL_FRAME || wrapsAround) {
+        if (!dirtyRects.empty()) {
+            rects.push_back(frame);
+        }
+        return rects;
+    }
+
+    for (const Rect &dirty : dirtyRects) {
+        Rect affected = expandRect(dirty, radius, height, width);
+        if (affected.area() > 0) {
+            rects.push_back(affected);
+        }
+    }
+
+    // 計算する窓(参照範囲だけ広げた矩形)が重なる矩形をまとめる
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size() && !merged; j++) {
+                Rect windowI = expandRect(rects[i], radius, height, width);
+                Rect windowJ = expandRect(rects[j], radius, height, width);
+                Rect joined  = rects[i] | rects[j];
+                if ((windowI & windowJ).area() > 0 &&
+                    expandRect(joined, radius, height, width).area() <= windowI.area() + windowJ.area()) {
+                    rects[i] = joined;
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                }
+            }
+        }
+    }
+    return rects;
+}
+
+/*************************************************
+ * Rect windowOf(Rect rect, int32_t height, int32_t width, Size radius, BorderType borderType)
+ * Rect rect : 出力する矩形
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Size radius : 処理の参照範囲
+ * BorderType borderType : 処理で使う画像の端の処理
+ *
+ * 機能 : 矩形の出力に必要な入力画像の窓 (矩形を参照範囲だけ広げて画像内に収めた矩形)
+ *        (Wrapは反対側の端を参照するため、画像の端に接する窓は画像全体)
+ *
+ * return : Rect 入力画像の窓
+ *************************************************/
+Rect windowOf(Rect rect, int32_t height, int32_t width, Size radius, BorderType borderType)
+{
+    Rect frame(0, 0, width, height);
+    Rect window = radius == FULL_FRAME ? frame : expandRect(rect, radius, height, width);
+    if (borderType == BorderType::Wrap && window != rect &&
+        (window.x == 0 || window.y == 0 || window.br().x == width || window.br().y == height)) {
+        window = frame;
+    }
+    return window;
+}
+
+/*************************************************
+ * void processRegions(Mat inImg, int32_t height, int32_t width, const std::vector<Rect> &dirtyRects, Size radius,
+ *                     BorderType borderType, const Op &op, Mat outImg)
+ * Mat inImg : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * const std::vector<Rect> &dirtyRects : 入力画像の変更された矩形 (処理したい領域)
+ * Size radius : 処理の参照範囲 (filterRadius、pixelwiseRadius、chainRadiusで求める)
+ * BorderType borderType : 処理で使う画像の端の処理
+ * const Op &op : 処理
+ * Mat outImg : 以前の処理結果が入った出力画像 (inImgと同じでもよい)
+ *
+ * 機能 : 変更された矩形の影響を受ける出力画像の部分だけを再計算する
+ *        影響を受ける矩形を参照範囲だけ広げた窓を部分画像として処理し、窓の内側を出力画像に書き込む
+ *        窓の縁が画像の端と一致する場合は処理の端の処理がそのまま使われる
+ *        (Wrapは反対側の端を参照するため、画像の端に接する窓は画像全体で処理する)
+ *        結果は画像全体を処理した場合と同じだが、分離できない大きなカーネルのConvolutionは
+ *        窓の大きさでFFTを使うかとブロックの位置が変わり、丸めが異なる画素がある
+ *        (同じ結果が必要な場合はsetTuningでConvolutionをVariant::Directにする)
+ *
+ * return : void
+ *************************************************/
+void processRegions(Mat inImg, int32_t height, int32_t width, const std::vector<Rect> &dirtyRects, Size radius,
+                    BorderType borderType, const Op &op, Mat outImg)
+{
+    std::vector<Rect> rects = affectedRects(dirtyRects, height, width, radius, borderType);
+    std::vector<Rect> windows;
+    std::vector<Mat>  results;
+
+    // すべての窓を処理してから書き込む (インプレース処理で他の窓の入力を上書きしないため)
+    for (const Rect &rect : rects) {
+        Rect window = windowOf(rect, height, width, radius, borderType);
+        Mat  result = Mat{window.height, window.width, CV_8UC3};
+        op(inImg(window), window.height, window.width, window, result);
+        windows.push_back(window);
+        results.push_back(result);
+    }
+
+    for (size_t i = 0; i < rects.size(); i++) {
+        Rect inner = rects[i] - windows[i].tl();
+        for (int32_t y = 0; y < inner.height; y++) {
+            const uint8_t *src = results[i].ptr<uint8_t>(inner.y + y) + inner.x * 3;
+            std::copy(src, src + inner.width * 3, outImg.ptr<uint8_t>(rects[i].y + y) + rects[i].x * 3);
+        }
+    }
+}
+
+}  // namespace roi
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../border.h"
+#include "../filter/filter.h"
+#include "../pixelwise/pixelwise.h"
+#include <cstdint>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+using namespace cv;
+
+namespace roi {
+
+// 画像全体を参照する処理の参照範囲 (ヒストグラム均等化など)
+const Size FULL_FRAME = Size(-1, -1);
+
+// op(inImg, height, width, window, outImg) : inImgは窓の部分画像、windowは画像全体での窓の位置
+// (画素ごとのパラメータ画像などを窓の位置で切り出すために使う)
+using Op = std::function<void(Mat inImg, int32_t height, int32_t width, Rect window, Mat outImg)>;
+
+Size pixelwiseRadius(pixelwise::IpsType ipsType);
+Size filterRadius(filter::IpsType ipsType, int32_t param1 = 0, int32_t param2 = 0);
+Size chainRadius(const std::vector<Size> &radii);
+
+Rect              windowOf(Rect rect, int32_t height, int32_t width, Size radius, BorderType borderType);
+std::vector<Rect> affectedRects(const std::vector<Rect> &dirtyRects, int32_t height, int32_t width, Size radius,
+                                BorderType borderType = BorderType::Replicate);
+void              processRegions(Mat inImg, int32_t height, int32_t width, const std::vector<Rect> &dirtyRects,
+                                 Size radius, BorderType borderType, const Op &op, Mat outImg);
+
+}  // namespace roi
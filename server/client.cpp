@@ -0,0 +1,162 @@
+#include "client.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace server {
+
+SharedFrame::~SharedFrame()
+{
+    release();
+}
+
+/*************************************************
+ * bool create(const std::string &name, int32_t height, int32_t width, bool separateOutput)
+ * const std::string &name : 共有メモリの名前 ("/name"、Request::shmNameに収まる長さ)
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * bool separateOutput : 出力画像を入力画像と別の領域に置く場合はtrue (falseはインプレース処理)
+ *
+ * 機能 : 共有メモリを作成して割り当てる
+ *
+ * return : bool 作成できた場合はtrue
+ *************************************************/
+bool SharedFrame::create(const std::string &name, int32_t height, int32_t width, bool separateOutput)
+{
+    release();
+    if (name.size() >= static_cast<size_t>(SHM_NAME_LEN) || height <= 0 || width <= 0) {
+        return false;
+    }
+
+    size_t frameBytes = static_cast<size_t>(height) * width * 3;
+    size_t size       = separateOutput ? frameBytes * 2 : frameBytes;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    name_      = name;
+    data_      = static_cast<uint8_t *>(data);
+    size_      = size;
+    height_    = height;
+    width_     = width;
+    outOffset_ = separateOutput ? static_cast<int64_t>(frameBytes) : 0;
+    return true;
+}
+
+/*************************************************
+ * void release()
+ *
+ * 機能 : 共有メモリの割り当てを解除して削除 (デーモン側の割り当ては処理が終わるまで残る)
+ *
+ * return : void
+ *************************************************/
+void SharedFrame::release()
+{
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        shm_unlink(name_.c_str());
+        data_ = nullptr;
+    }
+}
+
+void SharedFrame::fill(Request &request) const
+{
+    std::memset(request.shmName, 0, sizeof(request.shmName));
+    std::memcpy(request.shmName, name_.c_str(), name_.size());
+    request.inOffset  = 0;
+    request.outOffset = outOffset_;
+    request.height    = height_;
+    request.width     = width_;
+}
+
+Client::~Client()
+{
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+/*************************************************
+ * bool connect(const std::string &socketPath)
+ * const std::string &socketPath : デーモンのUnixドメインソケットのパス
+ *
+ * 機能 : デーモンに接続
+ *
+ * return : bool 接続できた場合はtrue
+ *************************************************/
+bool Client::connect(const std::string &socketPath)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::strcpy(addr.sun_path, socketPath.c_str());
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        return false;
+    }
+    if (::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+// 要求を送る (応答を待たずに続けて送ってもよい、応答はjobIdで対応付ける)
+bool Client::send(const Request &request)
+{
+    const uint8_t *p   = reinterpret_cast<const uint8_t *>(&request);
+    size_t         len = sizeof(request);
+    while (len > 0) {
+        ssize_t n = ::send(fd_, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 応答を1つ受け取る
+bool Client::receive(Reply &reply)
+{
+    uint8_t *p   = reinterpret_cast<uint8_t *>(&reply);
+    size_t   len = sizeof(reply);
+    while (len > 0) {
+        ssize_t n = ::read(fd_, p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return reply.magic == PROTOCOL_MAGIC;
+}
+
+// 要求を送り、応答を待つ
+bool Client::call(const Request &request, Reply &reply)
+{
+    return send(request) && receive(reply);
+}
+
+}  // namespace server
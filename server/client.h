@@ -0,0 +1,58 @@
+#pragma once
+
+#include "protocol.h"
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <string>
+
+using namespace cv;
+
+namespace server {
+
+// 入力画像と出力画像を置くPOSIX共有メモリ (クライアントが作成し、デーモンが同じ名前で開く)
+class SharedFrame
+{
+public:
+    SharedFrame() = default;
+    SharedFrame(const SharedFrame &) = delete;
+    SharedFrame &operator=(const SharedFrame &) = delete;
+    ~SharedFrame();
+
+    bool create(const std::string &name, int32_t height, int32_t width, bool separateOutput = true);
+    void release();
+
+    // 共有メモリ上の画像 (コピーせずに直接読み書きする)
+    Mat inImg() const { return Mat{height_, width_, CV_8UC3, data_}; }
+    Mat outImg() const { return Mat{height_, width_, CV_8UC3, data_ + outOffset_}; }
+
+    // 要求の共有メモリと画像の位置を設定
+    void fill(Request &request) const;
+
+private:
+    std::string name_;
+    uint8_t    *data_      = nullptr;
+    size_t      size_      = 0;
+    int32_t     height_    = 0;
+    int32_t     width_     = 0;
+    int64_t     outOffset_ = 0;
+};
+
+// デーモンへの接続
+class Client
+{
+public:
+    Client() = default;
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+    ~Client();
+
+    bool connect(const std::string &socketPath);
+    bool send(const Request &request);
+    bool receive(Reply &reply);
+    bool call(const Request &request, Reply &reply);
+
+private:
+    int fd_ = -1;
+};
+
+}  // namespace server
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+// デーモンとクライアントの間の要求と応答 (同じホスト上の固定長のバイナリ)
+// 画素データはPOSIX共有メモリで受け渡し、ソケットには要求と応答のみを流す
+namespace server {
+
+constexpr uint32_t PROTOCOL_MAGIC   = 0x49505344;  // "DSPI"
+constexpr uint32_t PROTOCOL_VERSION = 1;
+constexpr int32_t  SHM_NAME_LEN     = 64;
+constexpr int32_t  PARAM_NUM        = 4;
+
+// 要求の種類
+enum class RequestKind : int32_t
+{
+    Process = 0,  // 画像処理
+    Stats   = 1,  // 統計の取得
+};
+
+// 処理の種類 (ipsTypeはpixelwise::IpsTypeまたはfilter::IpsTypeの値)
+enum class Module : int32_t
+{
+    Pixelwise = 0,
+    Filter    = 1,
+};
+
+// 応答の状態
+enum class Status : int32_t
+{
+    Ok           = 0,
+    BadRequest   = 1,  // マジックナンバー、バージョン、画像の大きさや位置、パラメータが不正 (入出力の一部の重なりを含む)
+    ShmError     = 2,  // 共有メモリを開けない、または大きさが足りない
+    Unsupported  = 3,  // 対応していない処理
+    ShuttingDown = 4,
+    Error        = 5,  // 処理中の例外 (メモリ不足など)
+};
+
+struct Request
+{
+    uint32_t    magic   = PROTOCOL_MAGIC;
+    uint32_t    version = PROTOCOL_VERSION;
+    RequestKind kind    = RequestKind::Process;
+    uint32_t    jobId   = 0;  // 応答にそのまま返す (1つの接続で複数の要求を送る場合の対応付け)
+
+    char    shmName[SHM_NAME_LEN] = {};  // 入力画像と出力画像を置く共有メモリ ("/name")
+    int64_t inOffset              = 0;   // 共有メモリ内の入力画像の位置 (バイト、BGRの行を連続して格納)
+    int64_t outOffset             = 0;   // 共有メモリ内の出力画像の位置 (inOffsetと同じか、重ならない位置)
+    int32_t height                = 0;
+    int32_t width                 = 0;
+
+    Module  module                = Module::Pixelwise;
+    int32_t ipsType               = 0;
+    double  params[PARAM_NUM]     = {};  // 処理のパラメータ (処理ごとの意味はserver.cppのrunJobを参照)
+    int32_t borderType            = 0;   // BorderTypeの値
+    uint8_t borderValue[3]        = {};
+};
+
+struct Reply
+{
+    uint32_t magic  = PROTOCOL_MAGIC;
+    uint32_t jobId  = 0;
+    Status   status = Status::Ok;
+
+    // 要求ごとの計測値
+    double  queueMs    = 0.0;  // 待ち行列で待った時間
+    double  processMs  = 0.0;  // 処理時間
+    int32_t queueDepth = 0;    // 受け付けた時点の待ち行列の長さ
+
+    // RequestKind::Statsの応答のみ
+    uint64_t jobsDone      = 0;
+    double   meanLatencyMs = 0.0;  // 待ち時間と処理時間の和の平均
+    double   maxLatencyMs  = 0.0;
+    int32_t  maxQueueDepth = 0;
+};
+
+}  // namespace server
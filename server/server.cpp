@@ -0,0 +1,595 @@
+#include "server.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace server {
+
+namespace {
+constexpr size_t   MAX_MAPPINGS  = 16;  // 開いたままにする共有メモリの数
+constexpr uint64_t MAX_SHM_BYTES = std::min<uint64_t>(INT64_MAX, SIZE_MAX);  // 共有メモリの大きさ(off_t、size_t)の上限
+constexpr int32_t  MAX_RADIUS    = 1024;    // 近傍の半径の上限 (カーネルや作業用バッファの大きさを抑える)
+constexpr double   MAX_SIGMA     = 1024.0;  // バイラテラルフィルタの標準偏差の上限
+
+bool inRange(double value, double lo, double hi)
+{
+    return value >= lo && value <= hi;
+}
+
+// 固定長のデータをすべて読む (接続が閉じられた場合はfalse)
+bool readAll(int fd, void *buf, size_t len)
+{
+    uint8_t *p = static_cast<uint8_t *>(buf);
+    while (len > 0) {
+        ssize_t n = ::read(fd, p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(buf);
+    while (len > 0) {
+        ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+}  // namespace
+
+Server::Connection::~Connection()
+{
+    close(fd);
+}
+
+Server::Mapping::~Mapping()
+{
+    if (data != nullptr) {
+        munmap(data, size);
+    }
+}
+
+/*************************************************
+ * Server(std::string socketPath, int32_t workerNum, size_t cacheBytes)
+ * std::string socketPath : Unixドメインソケットのパス
+ * int32_t workerNum : ワーカスレッドの数 (0の場合はCPUのスレッド数)
+ * size_t cacheBytes : 処理結果のキャッシュの上限 (バイト)
+ *************************************************/
+Server::Server(std::string socketPath, int32_t workerNum, size_t cacheBytes)
+    : socketPath_(std::move(socketPath)), workerNum_(workerNum), resultCache_(cacheBytes)
+{
+    if (workerNum_ <= 0) {
+        workerNum_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+Server::~Server()
+{
+    stop();
+}
+
+/*************************************************
+ * void setProfile(tune::Profile profile)
+ * tune::Profile profile : 自動調整の設定 (tune::loadOrTuneで読み込むか計測する)
+ *
+ * 機能 : 各ワーカのフィルタ処理に指定する設定を保持 (runの前に呼ぶこと)
+ *
+ * return : void
+ *************************************************/
+void Server::setProfile(tune::Profile profile)
+{
+    profile_ = std::move(profile);
+}
+
+/*************************************************
+ * bool run()
+ *
+ * 機能 : ソケットで待ち受け、stopが呼ばれるまで要求を処理する (呼び出したスレッドで接続を受け付ける)
+ *
+ * return : bool 待ち受けを開始できなかった場合はfalse
+ *************************************************/
+bool Server::run()
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath_.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::strcpy(addr.sun_path, socketPath_.c_str());
+
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        return false;
+    }
+    unlink(socketPath_.c_str());
+    if (bind(listenFd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(listenFd_, 64) < 0) {
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    running_ = true;
+    for (int32_t i = 0; i < workerNum_; i++) {
+        workers_.emplace_back(&Server::workerLoop, this);
+    }
+
+    while (running_) {
+        int fd = accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (!running_) {
+                break;
+            }
+            continue;
+        }
+
+        auto conn = std::make_shared<Connection>();
+        conn->fd  = fd;
+
+        std::lock_guard<std::mutex> lock(connMutex_);
+        connFds_.push_back(fd);
+        std::thread(&Server::serveConnection, this, conn).detach();
+    }
+    return true;
+}
+
+/*************************************************
+ * void stop()
+ *
+ * 機能 : 待ち受けを終了し、待ち行列に残った要求を処理してからスレッドを終了する
+ *
+ * return : void
+ *************************************************/
+void Server::stop()
+{
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // acceptと接続ごとのreadを中断させる
+    shutdown(listenFd_, SHUT_RDWR);
+    close(listenFd_);
+    {
+        std::unique_lock<std::mutex> lock(connMutex_);
+        for (int fd : connFds_) {
+            shutdown(fd, SHUT_RD);
+        }
+        connCond_.wait(lock, [this] { return connFds_.empty(); });
+    }
+
+    queueCond_.notify_all();
+    for (std::thread &worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    unlink(socketPath_.c_str());
+}
+
+/*************************************************
+ * Reply stats() const
+ *
+ * 機能 : 処理した要求の数、待ち時間と処理時間の和の平均と最大、待ち行列の最大長を取得
+ *
+ * return : Reply 統計 (RequestKind::Statsの応答と同じ)
+ *************************************************/
+Reply Server::stats() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    Reply                       reply;
+    reply.jobsDone      = jobsDone_;
+    reply.meanLatencyMs = jobsDone_ > 0 ? totalLatencyMs_ / jobsDone_ : 0.0;
+    reply.maxLatencyMs  = maxLatencyMs_;
+    reply.maxQueueDepth = maxQueueDepth_;
+    return reply;
+}
+
+// 1つの接続から要求を読み、待ち行列に入れる
+void Server::serveConnection(std::shared_ptr<Connection> conn)
+{
+    Request request;
+    while (readAll(conn->fd, &request, sizeof(request))) {
+        if (request.kind == RequestKind::Stats) {
+            Reply reply = stats();
+            reply.jobId = request.jobId;
+            sendReply(*conn, reply);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (!running_) {
+            Reply reply;
+            reply.jobId  = request.jobId;
+            reply.status = Status::ShuttingDown;
+            sendReply(*conn, reply);
+            continue;
+        }
+        int32_t depth = static_cast<int32_t>(queue_.size());
+        queue_.push_back(Job{request, conn, std::chrono::steady_clock::now(), depth});
+        queueCond_.notify_one();
+    }
+
+    // 未処理の要求が応答を書き終えるまでfdは閉じない (Connectionの破棄時に閉じる)
+    std::lock_guard<std::mutex> lock(connMutex_);
+    connFds_.erase(std::remove(connFds_.begin(), connFds_.end(), conn->fd), connFds_.end());
+    connCond_.notify_all();
+}
+
+// 待ち行列から要求を取り出して処理する (処理クラスとそのLUT、作業用バッファはスレッドごとに使い回す)
+void Server::workerLoop()
+{
+    pixelwise::ImageProcessor ips;
+    filter::ImageProcessor    ips2;
+    profile_.apply(ips2, threadsPerWorker(workerNum_));
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCond_.wait(lock, [this] { return !queue_.empty() || !running_; });
+            if (queue_.empty()) {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        auto  started = std::chrono::steady_clock::now();
+        Reply reply;
+        reply.jobId = job.request.jobId;
+        try {
+            reply.status = runJob(job.request, ips, ips2);
+        } catch (const std::exception &) {
+            // 1つの要求の失敗で他のクライアントの処理を止めない
+            reply.status = Status::Error;
+        }
+
+        auto finished    = std::chrono::steady_clock::now();
+        reply.queueMs    = elapsedMs(job.enqueued, started);
+        reply.processMs  = elapsedMs(started, finished);
+        reply.queueDepth = job.queueDepth;
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            double                      latency = reply.queueMs + reply.processMs;
+            jobsDone_++;
+            totalLatencyMs_ += latency;
+            maxLatencyMs_  = std::max(maxLatencyMs_, latency);
+            maxQueueDepth_ = std::max(maxQueueDepth_, job.queueDepth);
+        }
+
+        sendReply(*job.conn, reply);
+    }
+}
+
+void Server::sendReply(Connection &conn, const Reply &reply)
+{
+    std::lock_guard<std::mutex> lock(conn.writeMutex);
+    writeAll(conn.fd, &reply, sizeof(reply));
+}
+
+/*************************************************
+ * Status runJob(const Request &request, pixelwise::ImageProcessor &ips, filter::ImageProcessor &ips2)
+ * const Request &request : 要求
+ * pixelwise::ImageProcessor &ips : 濃淡処理
+ * filter::ImageProcessor &ips2 : フィルタ処理
+ *
+ * 機能 : 共有メモリ上の入力画像を処理し、共有メモリ上の出力画像に直接書き込む
+ *
+ * return : Status 処理結果
+ *************************************************/
+Status Server::runJob(const Request &request, pixelwise::ImageProcessor &ips, filter::ImageProcessor &ips2)
+{
+    int32_t height = request.height;
+    int32_t width  = request.width;
+    if (request.magic != PROTOCOL_MAGIC || request.version != PROTOCOL_VERSION || height <= 0 || width <= 0 ||
+        request.inOffset < 0 || request.outOffset < 0) {
+        return Status::BadRequest;
+    }
+
+    // 画像の範囲が共有メモリに収まる大きさで、入力と出力が同じか重ならないことを確かめる
+    // (height * width * 3は正の2つのint32_tの積の3倍なのでuint64_tで桁あふれしない)
+    uint64_t frameBytes = static_cast<uint64_t>(height) * width * 3;
+    uint64_t inOffset   = static_cast<uint64_t>(request.inOffset);
+    uint64_t outOffset  = static_cast<uint64_t>(request.outOffset);
+    uint64_t maxOffset  = std::max(inOffset, outOffset);
+    uint64_t gap        = maxOffset - std::min(inOffset, outOffset);
+    if (frameBytes > MAX_SHM_BYTES || maxOffset > MAX_SHM_BYTES - frameBytes || (gap != 0 && gap < frameBytes)) {
+        return Status::BadRequest;
+    }
+
+    char name[SHM_NAME_LEN + 1] = {};
+    std::memcpy(name, request.shmName, SHM_NAME_LEN);
+
+    auto mapping = mapShm(name, static_cast<size_t>(maxOffset + frameBytes));
+    if (!mapping) {
+        return Status::ShmError;
+    }
+
+    // 共有メモリ上の画像をそのまま参照する (コピーしない)
+    Mat inImg  = Mat{height, width, CV_8UC3, mapping->data + request.inOffset};
+    Mat outImg = Mat{height, width, CV_8UC3, mapping->data + request.outOffset};
+    return processFrame(request, inImg, outImg, ips, ips2, &resultCache_);
+}
+
+/*************************************************
+ * int32_t threadsPerWorker(int32_t workerNum)
+ * int32_t workerNum : 並行して処理するワーカの数
+ *
+ * 機能 : 1つのワーカの処理が使うスレッド数の上限 (ワーカ数 x スレッド数が論理コア数を超えないようにする)
+ *
+ * return : int32_t スレッド数 (1以上)
+ *************************************************/
+int32_t threadsPerWorker(int32_t workerNum)
+{
+    int32_t cores = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+    return std::max(1, cores / std::max(workerNum, 1));
+}
+
+/*************************************************
+ * bool validParams(const Request &request)
+ * const Request &request : 要求 (module, ipsType, params, height, widthを使う)
+ *
+ * 機能 : パラメータが処理に渡せる範囲かを確かめる (整数に変換する前に、有限の値で範囲内であることを確かめる)
+ *        近傍の半径は画像の大きさとMAX_RADIUSの小さい方まで、構造要素の大きさは1以上その2倍 + 1まで
+ *
+ * return : bool 範囲内の場合はtrue
+ *************************************************/
+bool validParams(const Request &request)
+{
+    const double *p = request.params;
+    for (double param : request.params) {
+        if (!std::isfinite(param)) {
+            return false;
+        }
+    }
+
+    if (request.module == Module::Pixelwise) {
+        // ガンマ値が負の場合は0の画素値が無限大になる
+        return static_cast<pixelwise::IpsType>(request.ipsType) != pixelwise::IpsType::Gamma || p[0] > 0.0;
+    }
+
+    double maxRadius = std::min(MAX_RADIUS, std::max({request.height, request.width, 1}));
+    switch (static_cast<filter::IpsType>(request.ipsType)) {
+    case filter::IpsType::EqualizationFilter:
+    case filter::IpsType::AdaptiveThreshold:
+        return inRange(p[0], 0.0, maxRadius);
+    case filter::IpsType::BilateralFilter:
+        return p[0] > 0.0 && p[0] <= MAX_SIGMA && p[1] > 0.0 && p[1] <= MAX_SIGMA;
+    case filter::IpsType::ErodeFilter:
+    case filter::IpsType::DilateFilter:
+    case filter::IpsType::OpeningFilter:
+    case filter::IpsType::ClosingFilter:
+        return inRange(p[0], 1.0, 2 * maxRadius + 1) && inRange(p[1], 1.0, 2 * maxRadius + 1);
+    case filter::IpsType::BoxFilter:
+        // 半径は画素ごとの画像(8bit)で渡す
+        return inRange(p[0], 0.0, 255.0);
+    default:
+        return true;
+    }
+}
+
+/*************************************************
+ * cache::Key requestKey(const Request &request, Mat inImg)
+ * const Request &request : 要求 (module, ipsType, params, borderType, borderValue, height, widthを使う)
+ * Mat inImg : 入力画像
+ *
+ * 機能 : 処理結果のキャッシュのキーを求める (処理の種類、すべてのパラメータ、端の処理、入力画素のハッシュ値)
+ *
+ * return : cache::Key キー
+ *************************************************/
+cache::Key requestKey(const Request &request, Mat inImg)
+{
+    cache::KeyHasher hasher;
+    hasher.add(request.module).add(request.ipsType);
+    for (double param : request.params) {
+        hasher.add(param);
+    }
+    hasher.add(request.borderType).add(request.borderValue, sizeof(request.borderValue));
+    return hasher.addImage(inImg, request.height, request.width).key();
+}
+
+/*************************************************
+ * Status processFrame(const Request &request, Mat inImg, Mat outImg, pixelwise::ImageProcessor &ips,
+ *                     filter::ImageProcessor &ips2, cache::ResultCache *resultCache)
+ * const Request &request : 要求 (module, ipsType, params, borderType, borderValue, height, widthを使う)
+ * Mat inImg : 入力画像
+ * Mat outImg : 出力画像
+ * pixelwise::ImageProcessor &ips : 濃淡処理
+ * filter::ImageProcessor &ips2 : フィルタ処理
+ * cache::ResultCache *resultCache : 処理結果のキャッシュ (nullptrの場合は使わない)
+ *
+ * 機能 : 要求の処理を実行する (デーモンとバッチ処理で共通)
+ *        キャッシュにrequestKeyの結果があれば処理を省略し、なければ処理して成功した結果を保存する
+ *        パラメータがvalidParamsの範囲外の場合は処理しない
+ *        params : ToneCurve(coeff), Linear(a, b), Gamma(gammaVal), Sigmoid(k, x0), EqualizationFilter(filterCoeff),
+ *                 BilateralFilter(sigmaSpace, sigmaRange), 収縮・膨張・オープニング・クロージング(kernelW, kernelH),
+ *                 BoxFilter(半径), AdaptiveThreshold(blockRadius, k)
+ *
+ * return : Status 処理結果
+ *************************************************/
+Status processFrame(const Request &request, Mat inImg, Mat outImg, pixelwise::ImageProcessor &ips,
+                    filter::ImageProcessor &ips2, cache::ResultCache *resultCache)
+{
+    if (!validParams(request)) {
+        return Status::BadRequest;
+    }
+
+    if (resultCache != nullptr) {
+        // インプレース処理では入力画素が書き換わるため、処理の前にキーを求める
+        cache::Key key = requestKey(request, inImg);
+        if (resultCache->lookup(key, outImg, request.height, request.width)) {
+            return Status::Ok;
+        }
+        Status status = processFrame(request, inImg, outImg, ips, ips2);
+        if (status == Status::Ok) {
+            resultCache->store(key, outImg, request.height, request.width);
+        }
+        return status;
+    }
+
+    int32_t       height = request.height;
+    int32_t       width  = request.width;
+    const double *p      = request.params;
+
+    if (request.module == Module::Pixelwise) {
+        switch (static_cast<pixelwise::IpsType>(request.ipsType)) {
+        case pixelwise::IpsType::ToneCurve:
+            ips.toneCurve(inImg, height, width, p[0], outImg);
+            return Status::Ok;
+        case pixelwise::IpsType::Linear:
+            ips.effectLinear(inImg, height, width, p[0], p[1], outImg);
+            return Status::Ok;
+        case pixelwise::IpsType::Nega:
+            ips.effectNega(inImg, height, width, outImg);
+            return Status::Ok;
+        case pixelwise::IpsType::Gamma:
+            ips.effectGamma(inImg, height, width, p[0], outImg);
+            return Status::Ok;
+        case pixelwise::IpsType::Sigmoid:
+            ips.effectSigmoid(inImg, height, width, p[0], p[1], outImg);
+            return Status::Ok;
+        case pixelwise::IpsType::HistEqualization:
+            ips.histEqualization(inImg, height, width, outImg);
+            return Status::Ok;
+        case pixelwise::IpsType::HistEqualizationLuma:
+            ips.histEqualizationLuma(inImg, height, width, outImg);
+            return Status::Ok;
+        default:
+            return Status::Unsupported;
+        }
+    }
+
+    if (request.module != Module::Filter || request.borderType < 0 || request.borderType > 3) {
+        return Status::BadRequest;
+    }
+    ips2.setBorder(static_cast<BorderType>(request.borderType),
+                   Vec3b(request.borderValue[0], request.borderValue[1], request.borderValue[2]));
+
+    int32_t i0 = static_cast<int32_t>(p[0]);
+    int32_t i1 = static_cast<int32_t>(p[1]);
+    switch (static_cast<filter::IpsType>(request.ipsType)) {
+    case filter::IpsType::EqualizationFilter:
+        ips2.equalizationFilter(inImg, height, width, i0, outImg);
+        return Status::Ok;
+    case filter::IpsType::WeightedAverage:
+        ips2.weightedAverageFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::SharpeningFilter:
+        ips2.sharpeningFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::EdgeDetectionFilter:
+        ips2.edgeDetectionFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::SobelFilter:
+        ips2.sobelFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::PrewittFilter:
+        ips2.prewittFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::RobertsFilter:
+        ips2.robertsFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::EmbossingFilter:
+        ips2.embossingFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::MedianFilter:
+        ips2.medianFilter(inImg, height, width, outImg);
+        return Status::Ok;
+    case filter::IpsType::BilateralFilter:
+        ips2.bilateralFilter(inImg, height, width, p[0], p[1], outImg);
+        return Status::Ok;
+    case filter::IpsType::ErodeFilter:
+        ips2.erodeFilter(inImg, height, width, i0, i1, outImg);
+        return Status::Ok;
+    case filter::IpsType::DilateFilter:
+        ips2.dilateFilter(inImg, height, width, i0, i1, outImg);
+        return Status::Ok;
+    case filter::IpsType::OpeningFilter:
+        ips2.openingFilter(inImg, height, width, i0, i1, outImg);
+        return Status::Ok;
+    case filter::IpsType::ClosingFilter:
+        ips2.closingFilter(inImg, height, width, i0, i1, outImg);
+        return Status::Ok;
+    case filter::IpsType::BoxFilter:
+        ips2.boxFilter(inImg, height, width, Mat{height, width, CV_8UC1, Scalar(i0)}, outImg);
+        return Status::Ok;
+    case filter::IpsType::AdaptiveThreshold:
+        ips2.adaptiveThresholdFilter(inImg, height, width, i0, p[1], outImg);
+        return Status::Ok;
+    default:
+        // Convolutionはカーネルを要求に含められないため対象外
+        return Status::Unsupported;
+    }
+}
+
+// 共有メモリを割り当てる (同じ実体を割り当て済みならそのまま使う)
+std::shared_ptr<Server::Mapping> Server::mapShm(const std::string &name, size_t size)
+{
+    // クライアントが同じ名前で作り直した場合に古い実体を使わないよう、要求ごとに開いて実体を確かめる
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < size) {
+        close(fd);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mapMutex_);
+
+    for (auto it = mappings_.begin(); it != mappings_.end(); ++it) {
+        if ((*it)->name == name) {
+            if ((*it)->dev == st.st_dev && (*it)->ino == st.st_ino && (*it)->size == static_cast<size_t>(st.st_size)) {
+                close(fd);
+                mappings_.splice(mappings_.begin(), mappings_, it);
+                return mappings_.front();
+            }
+            // 作り直された、または大きさが変わった場合は割り当て直す
+            mappings_.erase(it);
+            break;
+        }
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto mapping  = std::make_shared<Mapping>();
+    mapping->name = name;
+    mapping->dev  = st.st_dev;
+    mapping->ino  = st.st_ino;
+    mapping->data = static_cast<uint8_t *>(data);
+    mapping->size = st.st_size;
+    mappings_.push_front(mapping);
+
+    // 使用中の割り当ては処理が終わるまでshared_ptrが保持する
+    if (mappings_.size() > MAX_MAPPINGS) {
+        mappings_.pop_back();
+    }
+    return mapping;
+}
+
+}  // namespace server
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../cache/cache.h"
+#include "../filter/filter.h"
+#include "../pixelwise/pixelwise.h"
+#include "../tune/tune.h"
+#include "protocol.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace server {
+
+constexpr size_t DEFAULT_CACHE_BYTES = 256 << 20;  // 処理結果のキャッシュの上限
+
+int32_t    threadsPerWorker(int32_t workerNum);
+bool       validParams(const Request &request);
+cache::Key requestKey(const Request &request, Mat inImg);
+Status     processFrame(const Request &request, Mat inImg, Mat outImg, pixelwise::ImageProcessor &ips,
+                        filter::ImageProcessor &ips2, cache::ResultCache *resultCache = nullptr);
+
+// 常駐して画像処理の要求を受け付けるデーモン
+// Unixドメインソケットで要求を受け、画素データは共有メモリ上で直接読み書きする
+// ワーカスレッド、共有メモリの割り当て、処理クラス(LUTと作業用バッファを含む)は要求をまたいで使い回す
+// 同じ入力画素と処理内容の要求は、ワーカ間で共有する処理結果のキャッシュから返す
+class Server
+{
+public:
+    explicit Server(std::string socketPath, int32_t workerNum = 0, size_t cacheBytes = DEFAULT_CACHE_BYTES);
+    ~Server();
+
+    void setProfile(tune::Profile profile);
+    bool run();
+    void stop();
+
+    Reply stats() const;
+
+private:
+    struct Connection
+    {
+        int        fd = -1;
+        std::mutex writeMutex;
+        ~Connection();
+    };
+
+    struct Job
+    {
+        Request                               request;
+        std::shared_ptr<Connection>           conn;
+        std::chrono::steady_clock::time_point enqueued;
+        int32_t                               queueDepth;
+    };
+
+    struct Mapping
+    {
+        std::string name;
+        dev_t       dev  = 0;  // 共有メモリの実体 (同じ名前で作り直された場合は異なる)
+        ino_t       ino  = 0;
+        uint8_t    *data = nullptr;
+        size_t      size = 0;
+        ~Mapping();
+    };
+
+    void serveConnection(std::shared_ptr<Connection> conn);
+    void workerLoop();
+    void sendReply(Connection &conn, const Reply &reply);
+
+    Status runJob(const Request &request, pixelwise::ImageProcessor &ips, filter::ImageProcessor &ips2);
+
+    std::shared_ptr<Mapping> mapShm(const std::string &name, size_t size);
+
+    std::string       socketPath_;
+    int32_t           workerNum_;
+    int               listenFd_ = -1;
+    std::atomic<bool> running_{false};
+
+    std::deque<Job>          queue_;
+    std::mutex               queueMutex_;
+    std::condition_variable  queueCond_;
+    std::vector<std::thread> workers_;
+    std::mutex               connMutex_;
+    std::condition_variable  connCond_;
+    std::vector<int>         connFds_;  // 接続中のソケット (接続ごとのスレッドはdetachし、終了時に取り除く)
+
+    std::list<std::shared_ptr<Mapping>> mappings_;  // 先頭が最近使った共有メモリ
+    std::mutex                          mapMutex_;
+
+    cache::ResultCache resultCache_;
+    tune::Profile      profile_;  // 各ワーカのフィルタ処理に指定する設定
+
+    mutable std::mutex statsMutex_;
+    uint64_t           jobsDone_       = 0;
+    double             totalLatencyMs_ = 0.0;
+    double             maxLatencyMs_   = 0.0;
+    int32_t            maxQueueDepth_  = 0;
+};
+
+}  // namespace server
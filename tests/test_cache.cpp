@@ -0,0 +1,75 @@
+#include "../cache/cache.h"
+#include "../filter/filter.h"
+#include "test_util.h"
+#include <filesystem>
+
+// キャッシュのヒット(メモリとディスク)で返る画像が、処理し直した結果と一致することを確かめる
+// 処理内容が異なるキーでは別の結果を返し、ハッシュ値だけが同じキーはミスになることも確かめる
+int32_t main()
+{
+    const std::string spillDir = "test_cache_spill";
+    int32_t           height   = 30;
+    int32_t           width    = 40;
+    size_t            frame    = static_cast<size_t>(height) * width * 3;
+
+    std::filesystem::remove_all(spillDir);
+    {
+        cache::ResultCache     resultCache(frame * 2, spillDir);  // メモリには2枚まで
+        filter::ImageProcessor ips2;
+        int32_t                calls = 0;
+
+        std::vector<Mat> inImgs;
+        for (uint32_t i = 0; i < 4; i++) {
+            inImgs.push_back(test::randomImage(height, width, i));
+        }
+
+        // キャッシュを通した平滑化フィルタの結果と、直接処理した結果の差
+        auto cachedDiff = [&](int32_t idx, int32_t filterCoeff) {
+            cache::Key key = cache::KeyHasher()
+                                 .addImage(inImgs[idx], height, width)
+                                 .add(std::string("EqualizationFilter"))
+                                 .add(filterCoeff)
+                                 .add(BorderType::Replicate)
+                                 .key();
+            Mat outImg = Mat{height, width, CV_8UC3};
+            resultCache.process(key, outImg, height, width, [&] {
+                calls++;
+                ips2.equalizationFilter(inImgs[idx], height, width, filterCoeff, outImg);
+            });
+
+            Mat refImg = Mat{height, width, CV_8UC3};
+            ips2.equalizationFilter(inImgs[idx], height, width, filterCoeff, refImg);
+            return test::maxDiff(outImg, refImg, height, width);
+        };
+
+        // メモリのヒット
+        TEST_CHECK(cachedDiff(0, 1) == 0);
+        TEST_CHECK(cachedDiff(0, 1) == 0);
+        TEST_CHECK(calls == 1);
+
+        // パラメータが異なる場合は処理し直す
+        TEST_CHECK(cachedDiff(0, 2) == 0);
+        TEST_CHECK(calls == 2);
+
+        // 追い出した結果のディスクからのヒット
+        TEST_CHECK(cachedDiff(1, 1) == 0);
+        TEST_CHECK(cachedDiff(2, 1) == 0);
+        TEST_CHECK(calls == 4);
+        TEST_CHECK(resultCache.stats().spills == 2);
+        TEST_CHECK(cachedDiff(0, 1) == 0);
+        TEST_CHECK(calls == 4);
+        TEST_CHECK(resultCache.stats().diskHits == 1);
+
+        // ハッシュ値が同じで内容が異なるキー
+        cache::Key stored = cache::KeyHasher().addImage(inImgs[3], height, width).add(int32_t(1)).key();
+        cache::Key other  = stored;
+        other.fields      = cache::KeyHasher().add(int32_t(2)).key().fields;
+        resultCache.store(stored, inImgs[3], height, width);
+        Mat outImg = Mat{height, width, CV_8UC3};
+        TEST_CHECK(resultCache.lookup(stored, outImg, height, width));
+        TEST_CHECK(test::maxDiff(outImg, inImgs[3], height, width) == 0);
+        TEST_CHECK(!resultCache.lookup(other, outImg, height, width));
+    }
+    std::filesystem::remove_all(spillDir);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "../filter/filter.h"
+#include "test_util.h"
+
+namespace {
+
+// 窓内の積和を倍精度で直接求める畳み込みの参照実装 (CV_64FC3)
+Mat directConvolve(Mat inImg, int32_t height, int32_t width, Mat kernel, BorderType borderType, Vec3b borderValue)
+{
+    Mat rawImg = Mat{height, width, CV_64FC3};
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            double sum[3] = {0, 0, 0};
+            for (int32_t ky = 0; ky < kernel.rows; ky++) {
+                for (int32_t kx = 0; kx < kernel.cols; kx++) {
+                    Vec3b  pix = test::borderPixel(inImg, height, width, y + ky - kernel.rows / 2,
+                                                   x + kx - kernel.cols / 2, borderType, borderValue);
+                    double k   = kernel.at<float>(ky, kx);
+                    for (int32_t c = 0; c < 3; c++) {
+                        sum[c] += k * pix[c];
+                    }
+                }
+            }
+            for (int32_t c = 0; c < 3; c++) {
+                rawImg.ptr<double>(y)[x * 3 + c] = sum[c];
+            }
+        }
+    }
+    return rawImg;
+}
+
+// 積和の画像と参照実装の差の最大値
+double maxRawDiff(Mat rawImg, Mat refImg, int32_t height, int32_t width)
+{
+    double diff = 0;
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t i = 0; i < width * 3; i++) {
+            diff = std::max(diff, std::abs(rawImg.ptr<float>(y)[i] - refImg.ptr<double>(y)[i]));
+        }
+    }
+    return diff;
+}
+
+}  // namespace
+
+// 大きいカーネルでFFT(重畳加算法)に切り替わる畳み込みと、直接計算(Variant::Direct)を倍精度の参照実装と比べる
+int32_t main()
+{
+    // 画像の高さ, 横幅, カーネルの高さ, 横幅 (大きいカーネルはFFT、小さいカーネルは直接計算になる)
+    const int32_t cases[][4] = {
+        {50, 60, 31, 31},
+        {20, 90, 33, 20},
+        {10, 12, 35, 35},
+        {70, 40, 13, 13},
+        {37, 29, 5,  3 },
+        {1,  1,  7,  7 },
+    };
+    Vec3b        borderValue = Vec3b(40, 0, 255);
+    std::mt19937 rng(11);
+
+    for (const auto &c : cases) {
+        int32_t height = c[0];
+        int32_t width  = c[1];
+        Mat     inImg  = test::randomImage(height, width, height * 100 + width);
+
+        // 分離できないカーネル (-0.3 ~ 0.7)
+        Mat    kernel = Mat{c[2], c[3], CV_32FC1};
+        double absSum = 0;
+        for (int32_t ky = 0; ky < kernel.rows; ky++) {
+            for (int32_t kx = 0; kx < kernel.cols; kx++) {
+                kernel.at<float>(ky, kx) = static_cast<float>(rng() % 1000) / 1000.f - 0.3f;
+                absSum += std::abs(kernel.at<float>(ky, kx));
+            }
+        }
+
+        // 積和は単精度で求めるため、積和の大きさの上限(255 * 係数の絶対値の和)に比例した誤差を許す
+        double tolerance = 2e-6 * 255 * absSum;
+
+        for (BorderType borderType : test::BORDER_TYPES) {
+            Mat refImg = directConvolve(inImg, height, width, kernel, borderType, borderValue);
+
+            filter::ImageProcessor ips, direct;
+            ips.setBorder(borderType, borderValue);
+            direct.setBorder(borderType, borderValue);
+            direct.setTuning(filter::IpsType::Convolution, filter::sizeClassOf(height, width),
+                             filter::TuneConfig{1, 0, filter::Variant::Direct});
+
+            Mat rawImg = Mat{height, width, CV_32FC3};
+            ips.convolveRaw(inImg, height, width, kernel, rawImg);
+            TEST_CHECK(maxRawDiff(rawImg, refImg, height, width) < tolerance);
+            direct.convolveRaw(inImg, height, width, kernel, rawImg);
+            TEST_CHECK(maxRawDiff(rawImg, refImg, height, width) < tolerance);
+        }
+    }
+    return 0;
+}
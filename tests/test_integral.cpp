@@ -0,0 +1,89 @@
+#include "../filter/filter.h"
+#include "test_util.h"
+
+namespace {
+
+// 窓内の画素値を直接足し合わせる可変半径の平滑化フィルタの参照実装
+Mat directBox(Mat inImg, int32_t height, int32_t width, Mat radiusMap, BorderType borderType, Vec3b borderValue)
+{
+    Mat outImg = Mat{height, width, CV_8UC3};
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            int32_t  r      = radiusMap.at<uint8_t>(y, x);
+            uint32_t area   = (2 * r + 1) * (2 * r + 1);
+            uint32_t sum[3] = {0, 0, 0};
+            for (int32_t yy = y - r; yy <= y + r; yy++) {
+                for (int32_t xx = x - r; xx <= x + r; xx++) {
+                    Vec3b pix = test::borderPixel(inImg, height, width, yy, xx, borderType, borderValue);
+                    for (int32_t c = 0; c < 3; c++) {
+                        sum[c] += pix[c];
+                    }
+                }
+            }
+            for (int32_t c = 0; c < 3; c++) {
+                outImg.at<Vec3b>(y, x)[c] = static_cast<uint8_t>(sum[c] / area);
+            }
+        }
+    }
+    return outImg;
+}
+
+}  // namespace
+
+// 積分画像による平滑化フィルタを直接計算する参照実装と比べる
+// 積分画像の実装(Variant::Integral)の平滑化フィルタと、帯を並列に処理した適応的二値化は既定の実装と比べる
+int32_t main()
+{
+    const int32_t sizes[][2]  = {{45, 61}, {1, 1}, {3, 40}, {50, 2}};
+    Vec3b         borderValue = Vec3b(200, 3, 90);
+    std::mt19937  rng(7);
+
+    for (const auto &size : sizes) {
+        int32_t height = size[0];
+        int32_t width  = size[1];
+        Mat     inImg  = test::randomImage(height, width, height * 100 + width);
+
+        Mat radiusMap = Mat{height, width, CV_8UC1};
+        for (int32_t y = 0; y < height; y++) {
+            for (int32_t x = 0; x < width; x++) {
+                radiusMap.at<uint8_t>(y, x) = static_cast<uint8_t>(rng() % 6);
+            }
+        }
+
+        for (BorderType borderType : test::BORDER_TYPES) {
+            filter::ImageProcessor ips, tuned;
+            ips.setBorder(borderType, borderValue);
+            tuned.setBorder(borderType, borderValue);
+            tuned.setTuning(filter::IpsType::BoxFilter, filter::sizeClassOf(height, width), filter::TuneConfig{3, 8});
+            tuned.setTuning(filter::IpsType::EqualizationFilter, filter::sizeClassOf(height, width),
+                            filter::TuneConfig{3, 8, filter::Variant::Integral});
+            tuned.setTuning(filter::IpsType::AdaptiveThreshold, filter::sizeClassOf(height, width),
+                            filter::TuneConfig{3, 8});
+
+            // 可変半径
+            Mat refImg = directBox(inImg, height, width, radiusMap, borderType, borderValue);
+            Mat outImg = Mat{height, width, CV_8UC3};
+            ips.boxFilter(inImg, height, width, radiusMap, outImg);
+            TEST_CHECK(test::maxDiff(outImg, refImg, height, width) == 0);
+            Mat inPlace = inImg.clone();
+            tuned.boxFilter(inPlace, height, width, radiusMap, inPlace);
+            TEST_CHECK(test::maxDiff(inPlace, refImg, height, width) == 0);
+
+            // 一定の半径
+            for (int32_t filterCoeff : {0, 1, 3}) {
+                Mat constMap = Mat{height, width, CV_8UC1, Scalar(filterCoeff)};
+                refImg       = directBox(inImg, height, width, constMap, borderType, borderValue);
+                ips.equalizationFilter(inImg, height, width, filterCoeff, outImg);
+                TEST_CHECK(test::maxDiff(outImg, refImg, height, width) == 0);
+                tuned.equalizationFilter(inImg, height, width, filterCoeff, outImg);
+                TEST_CHECK(test::maxDiff(outImg, refImg, height, width) == 0);
+            }
+
+            // 適応的二値化
+            ips.adaptiveThresholdFilter(inImg, height, width, 4, 0.3, refImg);
+            tuned.adaptiveThresholdFilter(inImg, height, width, 4, 0.3, outImg);
+            TEST_CHECK(test::maxDiff(outImg, refImg, height, width) == 0);
+        }
+    }
+    return 0;
+}
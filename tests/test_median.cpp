@@ -0,0 +1,64 @@
+#include "../filter/filter.h"
+#include "test_util.h"
+
+namespace {
+
+// 3x3の画素値をソートして中央値を求める参照実装
+Mat sortedMedian(Mat inImg, int32_t height, int32_t width, BorderType borderType, Vec3b borderValue)
+{
+    Mat outImg = Mat{height, width, CV_8UC3};
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            for (int32_t c = 0; c < 3; c++) {
+                uint8_t values[9];
+                int32_t idx = 0;
+                for (int32_t yy = -1; yy <= 1; yy++) {
+                    for (int32_t xx = -1; xx <= 1; xx++) {
+                        values[idx++] =
+                            test::borderPixel(inImg, height, width, y + yy, x + xx, borderType, borderValue)[c];
+                    }
+                }
+                std::sort(values, values + 9);
+                outImg.at<Vec3b>(y, x)[c] = values[4];
+            }
+        }
+    }
+    return outImg;
+}
+
+}  // namespace
+
+// 選択ネットワーク(Variant::Simd)と既定の実装のメディアンフィルタをソートによる参照実装と比べる
+// 複数スレッドの帯分割とインプレース処理も同じ結果になることを確かめる
+int32_t main()
+{
+    const int32_t         sizes[][2]  = {{41, 67}, {1, 1}, {2, 2}, {3, 18}, {33, 6}};  // 16画素値の倍数でない横幅を含む
+    const filter::Variant variants[]  = {filter::Variant::Scalar, filter::Variant::Simd};
+    Vec3b                 borderValue = Vec3b(0, 255, 77);
+
+    for (const auto &size : sizes) {
+        int32_t height = size[0];
+        int32_t width  = size[1];
+        Mat     inImg  = test::randomImage(height, width, height * 100 + width);
+
+        for (BorderType borderType : test::BORDER_TYPES) {
+            Mat refImg = sortedMedian(inImg, height, width, borderType, borderValue);
+
+            for (filter::Variant variant : variants) {
+                filter::ImageProcessor ips;
+                ips.setBorder(borderType, borderValue);
+                ips.setTuning(filter::IpsType::MedianFilter, filter::sizeClassOf(height, width),
+                              filter::TuneConfig{3, 4, variant});
+
+                Mat outImg = Mat{height, width, CV_8UC3};
+                ips.medianFilter(inImg, height, width, outImg);
+                TEST_CHECK(test::maxDiff(outImg, refImg, height, width) == 0);
+
+                Mat inPlace = inImg.clone();
+                ips.medianFilter(inPlace, height, width, inPlace);
+                TEST_CHECK(test::maxDiff(inPlace, refImg, height, width) == 0);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "../filter/filter.h"
+#include "test_util.h"
+
+namespace {
+
+// 窓内を1画素ずつ調べる収縮(IsMax=false)・膨張(IsMax=true)の参照実装
+Mat naiveMinMax(Mat inImg, int32_t height, int32_t width, int32_t kernelW, int32_t kernelH, BorderType borderType,
+                Vec3b borderValue, bool isMax)
+{
+    Mat outImg = Mat{height, width, CV_8UC3};
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            Vec3b result = isMax ? Vec3b(0, 0, 0) : Vec3b(255, 255, 255);
+            for (int32_t ky = 0; ky < kernelH; ky++) {
+                for (int32_t kx = 0; kx < kernelW; kx++) {
+                    Vec3b pix = test::borderPixel(inImg, height, width, y + ky - kernelH / 2, x + kx - kernelW / 2,
+                                                  borderType, borderValue);
+                    for (int32_t c = 0; c < 3; c++) {
+                        result[c] = isMax ? std::max(result[c], pix[c]) : std::min(result[c], pix[c]);
+                    }
+                }
+            }
+            outImg.at<Vec3b>(y, x) = result;
+        }
+    }
+    return outImg;
+}
+
+}  // namespace
+
+// van Herk/Gil-Werman法の収縮・膨張・オープニング・クロージングを1画素ずつ調べる参照実装と比べる
+int32_t main()
+{
+    const int32_t sizes[][2]   = {{37, 53}, {1, 1}, {20, 3}, {2, 40}};  // 16行の倍数でない高さを含む
+    const int32_t kernels[][2] = {{1, 1}, {2, 3}, {3, 1}, {5, 5}, {8, 4}, {45, 7}};
+    Vec3b         borderValue  = Vec3b(10, 128, 250);
+
+    for (const auto &size : sizes) {
+        int32_t height = size[0];
+        int32_t width  = size[1];
+        Mat     inImg  = test::randomImage(height, width, height * 100 + width);
+
+        for (BorderType borderType : test::BORDER_TYPES) {
+            filter::ImageProcessor ips;
+            ips.setBorder(borderType, borderValue);
+
+            for (const auto &kernel : kernels) {
+                int32_t kernelW = kernel[0];
+                int32_t kernelH = kernel[1];
+                Mat     eroded  = naiveMinMax(inImg, height, width, kernelW, kernelH, borderType, borderValue, false);
+                Mat     dilated = naiveMinMax(inImg, height, width, kernelW, kernelH, borderType, borderValue, true);
+                Mat     opened  = naiveMinMax(eroded, height, width, kernelW, kernelH, borderType, borderValue, true);
+                Mat     closed  = naiveMinMax(dilated, height, width, kernelW, kernelH, borderType, borderValue, false);
+                Mat     outImg  = Mat{height, width, CV_8UC3};
+
+                ips.erodeFilter(inImg, height, width, kernelW, kernelH, outImg);
+                TEST_CHECK(test::maxDiff(outImg, eroded, height, width) == 0);
+                ips.dilateFilter(inImg, height, width, kernelW, kernelH, outImg);
+                TEST_CHECK(test::maxDiff(outImg, dilated, height, width) == 0);
+                ips.openingFilter(inImg, height, width, kernelW, kernelH, outImg);
+                TEST_CHECK(test::maxDiff(outImg, opened, height, width) == 0);
+                ips.closingFilter(inImg, height, width, kernelW, kernelH, outImg);
+                TEST_CHECK(test::maxDiff(outImg, closed, height, width) == 0);
+
+                // インプレース処理
+                Mat inPlace = inImg.clone();
+                ips.erodeFilter(inPlace, height, width, kernelW, kernelH, inPlace);
+                TEST_CHECK(test::maxDiff(inPlace, eroded, height, width) == 0);
+            }
+        }
+    }
+    return 0;
+}
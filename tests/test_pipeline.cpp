@@ -0,0 +1,60 @@
+#include "../pipeline/pipeline.h"
+#include "../pixelwise/pixelwise.h"
+#include "test_util.h"
+
+// 融合したパイプラインと、各処理を中間画像を作って順に実行した結果を比べる
+// 融合できない処理を含む場合は実行時のパイプラインに切り替わっても同じ結果になることを確かめる
+int32_t main()
+{
+    const int32_t sizes[][2]  = {{41, 37}, {1, 1}, {3, 2}, {2, 9}, {20, 70}};
+    Vec3b         borderValue = Vec3b(9, 100, 230);
+
+    for (const auto &size : sizes) {
+        int32_t height = size[0];
+        int32_t width  = size[1];
+        Mat     inImg  = test::randomImage(height, width, height * 100 + width);
+
+        for (BorderType borderType : test::BORDER_TYPES) {
+            pixelwise::ImageProcessor ips;
+            filter::ImageProcessor    ips2;
+            ips2.setBorder(borderType, borderValue);
+
+            // 濃淡処理と3x3のフィルタの並び (1回の走査に融合される)
+            Mat refImg = inImg.clone();
+            ips.effectNega(refImg, height, width, refImg);
+            ips.effectGamma(refImg, height, width, 0.7, refImg);
+            ips2.sharpeningFilter(refImg, height, width, refImg);
+            ips.effectSigmoid(refImg, height, width, 3, 0.4, refImg);
+            ips2.sobelFilter(refImg, height, width, refImg);
+            ips2.medianFilter(refImg, height, width, refImg);
+            ips2.embossingFilter(refImg, height, width, refImg);
+            ips.effectLinear(refImg, height, width, 1.2, 10, refImg);
+
+            auto fused = pipeline::nega() | pipeline::gamma(0.7) | pipeline::sharpening() |
+                         pipeline::sigmoid(3, 0.4) | pipeline::sobel() | pipeline::median() | pipeline::embossing() |
+                         pipeline::linear(1.2, 10);
+            static_assert(decltype(fused)::FUSED);
+            fused.setBorder(borderType, borderValue);
+
+            Mat outImg = Mat{height, width, CV_8UC3};
+            fused.run(inImg, height, width, outImg);
+            TEST_CHECK(test::maxDiff(outImg, refImg, height, width) == 0);
+            Mat inPlace = inImg.clone();
+            fused.run(inPlace, height, width, inPlace);
+            TEST_CHECK(test::maxDiff(inPlace, refImg, height, width) == 0);
+
+            // 画像全体を参照する処理を含む並び (実行時のパイプラインで実行される)
+            refImg = inImg.clone();
+            ips.effectGamma(refImg, height, width, 1.5, refImg);
+            ips2.openingFilter(refImg, height, width, 5, 3, refImg);
+            ips2.weightedAverageFilter(refImg, height, width, refImg);
+
+            auto mixed = pipeline::gamma(1.5) | pipeline::opening(5, 3) | pipeline::weightedAverage();
+            static_assert(!decltype(mixed)::FUSED);
+            mixed.setBorder(borderType, borderValue);
+            mixed.run(inImg, height, width, outImg);
+            TEST_CHECK(test::maxDiff(outImg, refImg, height, width) == 0);
+        }
+    }
+    return 0;
+}
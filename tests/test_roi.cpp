@@ -0,0 +1,88 @@
+#include "../roi/roi.h"
+#include "test_util.h"
+
+namespace {
+
+struct Case
+{
+    const char *name;
+    Size        radius;
+    roi::Op     op;
+};
+
+}  // namespace
+
+// 変更された矩形の影響範囲だけを処理し直した結果と、変更後の画像全体を処理した結果を比べる
+int32_t main()
+{
+    int32_t           height      = 60;
+    int32_t           width       = 70;
+    Vec3b             borderValue = Vec3b(5, 6, 7);
+    std::vector<Rect> dirtyRects  = {Rect(10, 12, 5, 4), Rect(0, 50, 8, 10), Rect(66, 0, 4, 3), Rect(14, 14, 6, 6)};
+    std::mt19937      rng(3);
+
+    // 画素ごとの半径 (窓の位置で切り出して使う)
+    Mat radiusMap = Mat{height, width, CV_8UC1};
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            radiusMap.at<uint8_t>(y, x) = static_cast<uint8_t>(rng() % 4);
+        }
+    }
+
+    for (BorderType borderType : test::BORDER_TYPES) {
+        pixelwise::ImageProcessor ips;
+        filter::ImageProcessor    ips2;
+        ips2.setBorder(borderType, borderValue);
+
+        std::vector<Case> cases = {
+            {"median", roi::filterRadius(filter::IpsType::MedianFilter),
+             [&](Mat inImg, int32_t h, int32_t w, Rect, Mat outImg) { ips2.medianFilter(inImg, h, w, outImg); }},
+            {"opening", roi::filterRadius(filter::IpsType::OpeningFilter, 5, 4),
+             [&](Mat inImg, int32_t h, int32_t w, Rect, Mat outImg) { ips2.openingFilter(inImg, h, w, 5, 4, outImg); }},
+            {"box", roi::filterRadius(filter::IpsType::BoxFilter, 3),
+             [&](Mat inImg, int32_t h, int32_t w, Rect window, Mat outImg) {
+                 ips2.boxFilter(inImg, h, w, radiusMap(window), outImg);
+             }},
+            {"adaptive", roi::filterRadius(filter::IpsType::AdaptiveThreshold, 4),
+             [&](Mat inImg, int32_t h, int32_t w, Rect, Mat outImg) {
+                 ips2.adaptiveThresholdFilter(inImg, h, w, 4, 0.2, outImg);
+             }},
+            {"histEqualization", roi::pixelwiseRadius(pixelwise::IpsType::HistEqualization),
+             [&](Mat inImg, int32_t h, int32_t w, Rect, Mat outImg) { ips.histEqualization(inImg, h, w, outImg); }},
+            {"chain",
+             roi::chainRadius({roi::pixelwiseRadius(pixelwise::IpsType::Gamma),
+                               roi::filterRadius(filter::IpsType::SobelFilter),
+                               roi::filterRadius(filter::IpsType::EqualizationFilter, 2)}),
+             [&](Mat inImg, int32_t h, int32_t w, Rect, Mat outImg) {
+                 ips.effectGamma(inImg, h, w, 0.6, outImg);
+                 ips2.sobelFilter(outImg, h, w, outImg);
+                 ips2.equalizationFilter(outImg, h, w, 2, outImg);
+             }},
+        };
+
+        for (const Case &c : cases) {
+            // 変更前の画像全体の結果
+            Mat inImg  = test::randomImage(height, width, static_cast<uint32_t>(borderType));
+            Mat outImg = Mat{height, width, CV_8UC3};
+            c.op(inImg, height, width, Rect(0, 0, width, height), outImg);
+
+            // 矩形の画素を変更
+            for (const Rect &rect : dirtyRects) {
+                for (int32_t y = rect.y; y < rect.y + rect.height; y++) {
+                    for (int32_t x = rect.x; x < rect.x + rect.width; x++) {
+                        inImg.at<Vec3b>(y, x) = Vec3b(rng() & 0xff, rng() & 0xff, rng() & 0xff);
+                    }
+                }
+            }
+
+            Mat refImg = Mat{height, width, CV_8UC3};
+            c.op(inImg, height, width, Rect(0, 0, width, height), refImg);
+            roi::processRegions(inImg, height, width, dirtyRects, c.radius, borderType, c.op, outImg);
+            if (test::maxDiff(outImg, refImg, height, width) != 0) {
+                std::printf("%s: border %d differs from the full frame\n", c.name, static_cast<int32_t>(borderType));
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "../tiled/tiled.h"
+#include "test_util.h"
+
+// タイル形式で書き込んだ画像を読み戻し、元の画像と各レベルの縮小画像に一致することを確かめる
+// 領域の処理は画像全体を処理した結果の同じ領域と比べる
+int32_t main()
+{
+    const char              *path           = "test_tiled.tiled";
+    const int32_t            sizes[][3]     = {{301, 257, 64}, {318, 297, 64}, {335, 337, 300}};  // 高さ, 横幅, タイル
+    const tiled::Compression compressions[] = {tiled::Compression::None, tiled::Compression::Lz};
+
+    for (const auto &size : sizes) {
+        int32_t height   = size[0];
+        int32_t width    = size[1];
+        int32_t tileSize = size[2];
+
+        // 乱数の画像と、圧縮が効く緩やかな濃淡の画像
+        for (int32_t pattern = 0; pattern < 2; pattern++) {
+            Mat img = test::randomImage(height, width, height * 100 + width);
+            if (pattern == 1) {
+                for (int32_t y = 0; y < height; y++) {
+                    for (int32_t x = 0; x < width; x++) {
+                        img.at<Vec3b>(y, x) = Vec3b(x / 3, y / 2, (x + y) / 5);
+                    }
+                }
+            }
+
+            for (tiled::Compression compression : compressions) {
+                TEST_CHECK(tiled::write(path, img, height, width, tileSize, compression));
+
+                tiled::TiledImage tiledImg;
+                TEST_CHECK(tiledImg.open(path));
+                TEST_CHECK(tiledImg.levels() == tiled::DEFAULT_LEVELS);
+                TEST_CHECK(tiledImg.height() == height && tiledImg.width() == width);
+
+                // 等倍と縮小画像 (previewと同じpyrDown)
+                Mat level = img;
+                for (int32_t l = 0; l < tiledImg.levels(); l++) {
+                    if (l > 0) {
+                        pyrDown(level, level);
+                    }
+                    TEST_CHECK(tiledImg.height(l) == level.rows && tiledImg.width(l) == level.cols);
+                    Mat readImg = tiledImg.readRegion(Rect(0, 0, level.cols, level.rows), l);
+                    TEST_CHECK(test::maxDiff(readImg, level, level.rows, level.cols) == 0);
+                }
+
+                // タイルの境界をまたぐ領域
+                Rect rect    = Rect(60, 50, 90, 40);
+                Mat  readImg = tiledImg.readRegion(rect);
+                TEST_CHECK(test::maxDiff(readImg, img(rect), rect.height, rect.width) == 0);
+
+                // 領域の処理
+                filter::ImageProcessor ips2;
+                ips2.setBorder(BorderType::Reflect101);
+                roi::Op op = [&](Mat inImg, int32_t h, int32_t w, Rect, Mat outImg) {
+                    ips2.openingFilter(inImg, h, w, 5, 3, outImg);
+                };
+                Mat refImg = Mat{height, width, CV_8UC3};
+                op(img, height, width, Rect(0, 0, width, height), refImg);
+
+                for (Rect region : {Rect(100, 120, 50, 40), Rect(0, 0, 20, 20), Rect(width - 10, height - 7, 10, 7)}) {
+                    Mat outImg = Mat{region.height, region.width, CV_8UC3};
+                    TEST_CHECK(tiledImg.process(region, 0, roi::filterRadius(filter::IpsType::OpeningFilter, 5, 3),
+                                                BorderType::Reflect101, op, outImg));
+                    TEST_CHECK(test::maxDiff(outImg, refImg(region), region.height, region.width) == 0);
+                }
+            }
+        }
+    }
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../border.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <opencv2/opencv.hpp>
+#include <random>
+
+using namespace cv;
+
+// 条件を満たさない場合は場所を表示してmainから1を返す (ctestで失敗になる)
+#define TEST_CHECK(cond)                                                                                               \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                       \
+            return 1;                                                                                                  \
+        }                                                                                                              \
+    } while (0)
+
+namespace test {
+
+constexpr BorderType BORDER_TYPES[] = {BorderType::Replicate, BorderType::Reflect101, BorderType::Constant,
+                                       BorderType::Wrap};
+
+/*************************************************
+ * Mat randomImage(int32_t height, int32_t width, uint32_t seed)
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * uint32_t seed : 疑似乱数の種 (同じ種からは同じ画像を作る)
+ *
+ * 機能 : 画素値が一様乱数の画像を作成
+ *
+ * return : Mat 画像 (CV_8UC3)
+ *************************************************/
+inline Mat randomImage(int32_t height, int32_t width, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    Mat          img = Mat{height, width, CV_8UC3};
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t *row = img.ptr<uint8_t>(y);
+        for (int32_t i = 0; i < width * 3; i++) {
+            row[i] = static_cast<uint8_t>(rng() & 0xff);
+        }
+    }
+    return img;
+}
+
+/*************************************************
+ * int32_t maxDiff(Mat img1, Mat img2, int32_t height, int32_t width)
+ * Mat img1 : 画像1
+ * Mat img2 : 画像2
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ *
+ * 機能 : 2つの画像の画素値の差の最大値を求める
+ *
+ * return : int32_t 差の最大値 (一致する場合は0)
+ *************************************************/
+inline int32_t maxDiff(Mat img1, Mat img2, int32_t height, int32_t width)
+{
+    int32_t diff = 0;
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t *row1 = img1.ptr<uint8_t>(y);
+        const uint8_t *row2 = img2.ptr<uint8_t>(y);
+        for (int32_t i = 0; i < width * 3; i++) {
+            diff = std::max(diff, std::abs(row1[i] - row2[i]));
+        }
+    }
+    return diff;
+}
+
+/*************************************************
+ * Vec3b borderPixel(Mat img, int32_t height, int32_t width, int32_t y, int32_t x, BorderType borderType,
+ *                   Vec3b borderValue)
+ * Mat img : 画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t y : y座標 (範囲外でもよい)
+ * int32_t x : x座標 (範囲外でもよい)
+ * BorderType borderType : 画像の端の処理
+ * Vec3b borderValue : BorderType::Constantの画素値
+ *
+ * 機能 : 画像の端の処理を行った画素値を取得 (参照実装用)
+ *
+ * return : Vec3b 画素値
+ *************************************************/
+inline Vec3b borderPixel(Mat img, int32_t height, int32_t width, int32_t y, int32_t x, BorderType borderType,
+                         Vec3b borderValue)
+{
+    int32_t srcY = borderIndex(y, height, borderType);
+    int32_t srcX = borderIndex(x, width, borderType);
+    return srcY >= 0 && srcX >= 0 ? img.at<Vec3b>(srcY, srcX) : borderValue;
+}
+
+}  // namespace test
@@ -0,0 +1,594 @@
+#include "tiled.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tiled {
+
+namespace {
+constexpr int32_t MAX_LEVELS    = 16;
+constexpr int32_t MAX_TILE_SIZE = 16384;  // タイルの1辺の上限 (無圧縮のタイルのバイト数が索引のsizeに収まる)
+constexpr int32_t HASH_BITS     = 12;  // 圧縮の一致探索のハッシュ表 (4096要素)
+constexpr size_t  MIN_MATCH     = 4;
+constexpr size_t  LAST_LITERALS = 5;   // LZ4ブロック形式の規則 : 末尾の5バイトはリテラル
+constexpr size_t  MF_LIMIT      = 12;  // LZ4ブロック形式の規則 : 一致は末尾から12バイトより前で始まる
+constexpr size_t  MAX_OFFSET    = 65535;
+
+// ファイルの先頭 (続いてレベルごとの大きさ、全レベルのタイルの索引、タイルのデータの順に格納)
+struct FileHeader
+{
+    uint32_t    magic;
+    uint32_t    version;
+    int32_t     height;
+    int32_t     width;
+    int32_t     tileSize;
+    int32_t     levels;
+    Compression compression;
+    int32_t     reserved;
+};
+
+struct LevelHeader
+{
+    int32_t height;
+    int32_t width;
+};
+
+// 索引の1要素 (TiledImage::TileEntryと同じ配置)
+struct IndexEntry
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t compressed;
+};
+
+inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+size_t lzBound(size_t n)
+{
+    return n + n / 255 + 16;
+}
+
+// リテラルや一致の長さの15以上の部分を255ずつ書き込む
+void writeLength(uint8_t *dst, size_t &op, size_t len)
+{
+    for (; len >= 255; len -= 255) {
+        dst[op++] = 255;
+    }
+    dst[op++] = static_cast<uint8_t>(len);
+}
+
+/*************************************************
+ * size_t lzCompress(const uint8_t *src, size_t n, uint8_t *dst)
+ * const uint8_t *src : 入力
+ * size_t n : 入力のバイト数
+ * uint8_t *dst : 出力 (lzBound(n)バイト以上)
+ *
+ * 機能 : LZ4ブロック形式で圧縮 (4バイトのハッシュ表で直前の一致を探す貪欲法)
+ *
+ * return : size_t 出力のバイト数
+ *************************************************/
+size_t lzCompress(const uint8_t *src, size_t n, uint8_t *dst)
+{
+    std::vector<int64_t> table(static_cast<size_t>(1) << HASH_BITS, -1);
+    size_t               anchor = 0, ip = 0, op = 0;
+
+    while (n > MF_LIMIT && ip < n - MF_LIMIT) {
+        uint32_t seq = read32(src + ip);
+        uint32_t h   = (seq * 2654435761u) >> (32 - HASH_BITS);
+        int64_t  ref = table[h];
+        table[h]     = static_cast<int64_t>(ip);
+        if (ref < 0 || ip - ref > MAX_OFFSET || read32(src + ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        // 一致を伸ばす (末尾のLAST_LITERALSバイトは含めない)
+        size_t matchEnd = ip + MIN_MATCH;
+        while (matchEnd < n - LAST_LITERALS && src[matchEnd] == src[ref + (matchEnd - ip)]) {
+            matchEnd++;
+        }
+
+        size_t   litLen   = ip - anchor;
+        size_t   matchLen = matchEnd - ip - MIN_MATCH;
+        uint8_t &token    = dst[op++];
+        token = static_cast<uint8_t>((std::min<size_t>(litLen, 15) << 4) | std::min<size_t>(matchLen, 15));
+        if (litLen >= 15) {
+            writeLength(dst, op, litLen - 15);
+        }
+        std::memcpy(dst + op, src + anchor, litLen);
+        op += litLen;
+
+        size_t offset = ip - ref;
+        dst[op++]     = static_cast<uint8_t>(offset & 0xFF);
+        dst[op++]     = static_cast<uint8_t>(offset >> 8);
+        if (matchLen >= 15) {
+            writeLength(dst, op, matchLen - 15);
+        }
+
+        ip     = matchEnd;
+        anchor = ip;
+    }
+
+    // 残りはリテラル
+    size_t litLen = n - anchor;
+    dst[op++]     = static_cast<uint8_t>(std::min<size_t>(litLen, 15) << 4);
+    if (litLen >= 15) {
+        writeLength(dst, op, litLen - 15);
+    }
+    std::memcpy(dst + op, src + anchor, litLen);
+    return op + litLen;
+}
+
+/*************************************************
+ * bool lzDecompress(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen)
+ * const uint8_t *src : 圧縮したデータ
+ * size_t srcLen : 圧縮したデータのバイト数
+ * uint8_t *dst : 出力
+ * size_t dstLen : 展開後のバイト数
+ *
+ * 機能 : LZ4ブロック形式を展開 (範囲外の参照や長さの不一致は不正なデータとする)
+ *
+ * return : bool 不正なデータの場合はfalse
+ *************************************************/
+bool lzDecompress(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen)
+{
+    size_t ip = 0, op = 0;
+
+    // 15以上の長さの続き
+    auto readLength = [&](size_t &len) {
+        uint8_t b;
+        do {
+            if (ip >= srcLen) {
+                return false;
+            }
+            b = src[ip++];
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < srcLen) {
+        uint8_t token  = src[ip++];
+        size_t  litLen = token >> 4;
+        if ((litLen == 15 && !readLength(litLen)) || litLen > srcLen - ip || litLen > dstLen - op) {
+            return false;
+        }
+        std::memcpy(dst + op, src + ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == srcLen) {
+            break;  // 最後はリテラルのみ
+        }
+
+        if (srcLen - ip < 2) {
+            return false;
+        }
+        size_t offset   = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+        size_t matchLen = token & 0x0F;
+        ip += 2;
+        if (offset == 0 || offset > op || (matchLen == 15 && !readLength(matchLen))) {
+            return false;
+        }
+        matchLen += MIN_MATCH;
+        if (matchLen > dstLen - op) {
+            return false;
+        }
+
+        // 重なる場合があるため1バイトずつコピー
+        for (size_t i = 0; i < matchLen; i++) {
+            dst[op + i] = dst[op - offset + i];
+        }
+        op += matchLen;
+    }
+    return op == dstLen;
+}
+
+// 行ごとに左隣の画素との差分に変換 (画素値の変化が小さい画像で一致が増える)
+void deltaEncode(uint8_t *data, int32_t rows, int32_t rowBytes)
+{
+    for (int32_t y = 0; y < rows; y++) {
+        uint8_t *row = data + static_cast<size_t>(y) * rowBytes;
+        for (int32_t i = rowBytes - 1; i >= 3; i--) {
+            row[i] = static_cast<uint8_t>(row[i] - row[i - 3]);
+        }
+    }
+}
+
+void deltaDecode(uint8_t *data, int32_t rows, int32_t rowBytes)
+{
+    for (int32_t y = 0; y < rows; y++) {
+        uint8_t *row = data + static_cast<size_t>(y) * rowBytes;
+        for (int32_t i = 3; i < rowBytes; i++) {
+            row[i] = static_cast<uint8_t>(row[i] + row[i - 3]);
+        }
+    }
+}
+
+int32_t tilesOf(int32_t len, int32_t tileSize)
+{
+    return static_cast<int32_t>((static_cast<int64_t>(len) + tileSize - 1) / tileSize);
+}
+}  // namespace
+
+/*************************************************
+ * bool write(const std::string &path, Mat img, int32_t height, int32_t width, int32_t tileSize,
+ *            Compression compression, int32_t levels)
+ * const std::string &path : 出力するファイル
+ * Mat img : 入力画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * int32_t tileSize : タイルの1辺の画素数
+ * Compression compression : タイルの圧縮
+ * int32_t levels : 画像ピラミッドのレベル数 (1辺が1画素になった場合はそこまで)
+ *
+ * 機能 : 画像ピラミッドを作成し、各レベルをタイルに分けてタイル形式のファイルに書き出す
+ *
+ * return : bool 書き込めなかった場合はfalse
+ *************************************************/
+bool write(const std::string &path, Mat img, int32_t height, int32_t width, int32_t tileSize, Compression compression,
+           int32_t levels)
+{
+    if (height <= 0 || width <= 0 || tileSize <= 0 || tileSize > MAX_TILE_SIZE || levels <= 0 ||
+        img.type() != CV_8UC3) {
+        return false;
+    }
+
+    std::vector<Mat> pyramid(1, img(Rect(0, 0, width, height)));
+    while (static_cast<int32_t>(pyramid.size()) < std::min(levels, MAX_LEVELS) && pyramid.back().rows > 1 &&
+           pyramid.back().cols > 1) {
+        Mat down;
+        pyrDown(pyramid.back(), down);
+        pyramid.push_back(down);
+    }
+
+    FileHeader header{TILED_MAGIC, TILED_VERSION, height, width, tileSize, static_cast<int32_t>(pyramid.size()),
+                      compression, 0};
+    std::vector<LevelHeader> levelHeaders;
+    size_t                   tileNum = 0;
+    for (const Mat &level : pyramid) {
+        levelHeaders.push_back(LevelHeader{level.rows, level.cols});
+        tileNum += static_cast<size_t>(tilesOf(level.rows, tileSize)) * tilesOf(level.cols, tileSize);
+    }
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    size_t        dataOffset =
+        sizeof(header) + sizeof(LevelHeader) * levelHeaders.size() + sizeof(IndexEntry) * tileNum;
+    ofs.seekp(static_cast<std::streamoff>(dataOffset));
+
+    std::vector<IndexEntry> index;
+    std::vector<uint8_t>    raw(static_cast<size_t>(tileSize) * tileSize * 3);
+    std::vector<uint8_t>    delta(raw.size());
+    std::vector<uint8_t>    packed(lzBound(raw.size()));
+    uint64_t                offset = dataOffset;
+
+    for (const Mat &level : pyramid) {
+        Rect frame(0, 0, level.cols, level.rows);
+        for (int32_t ty = 0; ty < tilesOf(level.rows, tileSize); ty++) {
+            for (int32_t tx = 0; tx < tilesOf(level.cols, tileSize); tx++) {
+                // タイルの画素を連続した行に集める (右端と下端のタイルは小さい)
+                Rect   rect     = Rect(tx * tileSize, ty * tileSize, tileSize, tileSize) & frame;
+                size_t rowBytes = static_cast<size_t>(rect.width) * 3;
+                size_t rawBytes = rowBytes * rect.height;
+                for (int32_t y = 0; y < rect.height; y++) {
+                    const uint8_t *src = level.ptr<uint8_t>(rect.y + y) + rect.x * 3;
+                    std::copy(src, src + rowBytes, &raw[y * rowBytes]);
+                }
+
+                IndexEntry     entry{offset, static_cast<uint32_t>(rawBytes), 0};
+                const uint8_t *out = raw.data();
+                if (compression == Compression::Lz) {
+                    std::copy(raw.begin(), raw.begin() + rawBytes, delta.begin());
+                    deltaEncode(delta.data(), rect.height, static_cast<int32_t>(rowBytes));
+                    size_t packedBytes = lzCompress(delta.data(), rawBytes, packed.data());
+                    if (packedBytes < rawBytes) {
+                        entry = IndexEntry{offset, static_cast<uint32_t>(packedBytes), 1};
+                        out   = packed.data();
+                    }
+                }
+
+                ofs.write(reinterpret_cast<const char *>(out), entry.size);
+                offset += entry.size;
+                index.push_back(entry);
+            }
+        }
+    }
+
+    // 先頭に戻って大きさと索引を書き込む
+    ofs.seekp(0);
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char *>(levelHeaders.data()), sizeof(LevelHeader) * levelHeaders.size());
+    ofs.write(reinterpret_cast<const char *>(index.data()), sizeof(IndexEntry) * index.size());
+    return static_cast<bool>(ofs);
+}
+
+/*************************************************
+ * bool convertBmp(const std::string &bmpPath, const std::string &tiledPath, int32_t tileSize,
+ *                 Compression compression, int32_t levels)
+ * const std::string &bmpPath : 入力するBMPファイル
+ * const std::string &tiledPath : 出力するタイル形式のファイル
+ * int32_t tileSize : タイルの1辺の画素数
+ * Compression compression : タイルの圧縮
+ * int32_t levels : 画像ピラミッドのレベル数
+ *
+ * 機能 : BMPファイルをタイル形式に変換 (以降はBMPを読み込まずにタイル形式から読み込む)
+ *
+ * return : bool 読み込めない、または書き込めなかった場合はfalse
+ *************************************************/
+bool convertBmp(const std::string &bmpPath, const std::string &tiledPath, int32_t tileSize, Compression compression,
+                int32_t levels)
+{
+    Mat img = imread(bmpPath);
+    if (img.empty()) {
+        return false;
+    }
+    return write(tiledPath, img, img.rows, img.cols, tileSize, compression, levels);
+}
+
+/*************************************************
+ * TiledImage(size_t cacheBytes)
+ * size_t cacheBytes : 展開したタイルをメモリ上に保持するバイト数の上限
+ *************************************************/
+TiledImage::TiledImage(size_t cacheBytes) : decoded_(cacheBytes)
+{
+}
+
+TiledImage::~TiledImage()
+{
+    close();
+}
+
+/*************************************************
+ * bool open(const std::string &path)
+ * const std::string &path : タイル形式のファイル
+ *
+ * 機能 : ファイルをメモリマップで開き、大きさと索引を読み込む (タイルのデータはまだ読まない)
+ *        各レベルの大きさは等倍の大きさを2^level分の1に切り上げた大きさまでとし、
+ *        索引の要素数はファイルに収まる数までとする (乗算が桁あふれしない範囲で確かめる)
+ *
+ * return : bool 開けない、または形式が不正な場合はfalse
+ *************************************************/
+bool TiledImage::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    // 必要なタイルだけを読むため先読みしない
+    madvise(mapped, st.st_size, MADV_RANDOM);
+    data_     = static_cast<const uint8_t *>(mapped);
+    fileSize_ = st.st_size;
+
+    FileHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (header.magic != TILED_MAGIC || header.version != TILED_VERSION || header.tileSize <= 0 ||
+        header.tileSize > MAX_TILE_SIZE || header.levels <= 0 || header.levels > MAX_LEVELS ||
+        fileSize_ < sizeof(header) + sizeof(LevelHeader) * header.levels) {
+        close();
+        return false;
+    }
+    tileSize_ = header.tileSize;
+
+    // ファイルに収まる索引の要素数
+    size_t indexOffset = sizeof(header) + sizeof(LevelHeader) * header.levels;
+    size_t maxTiles    = (fileSize_ - indexOffset) / sizeof(IndexEntry);
+
+    size_t tileNum = 0;
+    for (int32_t l = 0; l < header.levels; l++) {
+        LevelHeader levelHeader;
+        std::memcpy(&levelHeader, data_ + sizeof(header) + sizeof(LevelHeader) * l, sizeof(levelHeader));
+
+        // 等倍のレベルはヘッダの大きさと同じ、縮小したレベルは等倍の2^l分の1 (切り上げ) まで
+        int32_t maxH = l == 0 ? header.height : ((levels_[0].height - 1) >> l) + 1;
+        int32_t maxW = l == 0 ? header.width : ((levels_[0].width - 1) >> l) + 1;
+        if (levelHeader.height <= 0 || levelHeader.width <= 0 ||
+            (l == 0 && (levelHeader.height != maxH || levelHeader.width != maxW)) || levelHeader.height > maxH ||
+            levelHeader.width > maxW) {
+            close();
+            return false;
+        }
+
+        Level  level{levelHeader.height, levelHeader.width, tilesOf(levelHeader.width, tileSize_),
+                     tilesOf(levelHeader.height, tileSize_), tileNum};
+        size_t levelTiles = static_cast<size_t>(level.tilesX) * level.tilesY;
+        if (levelTiles > maxTiles - tileNum) {
+            close();
+            return false;
+        }
+        tileNum += levelTiles;
+        levels_.push_back(level);
+    }
+
+    index_.resize(tileNum);
+    std::memcpy(index_.data(), data_ + indexOffset, sizeof(IndexEntry) * tileNum);
+
+    // タイルがファイル内にあり、無圧縮のタイルの大きさが正しいか確かめる
+    for (const Level &level : levels_) {
+        size_t levelTiles = static_cast<size_t>(level.tilesX) * level.tilesY;
+        for (size_t i = 0; i < levelTiles; i++) {
+            const TileEntry &entry = index_[level.firstTile + i];
+            int64_t          tileY = static_cast<int64_t>(i / level.tilesX) * tileSize_;
+            int64_t          tileX = static_cast<int64_t>(i % level.tilesX) * tileSize_;
+            int64_t          tileH = std::min<int64_t>(tileSize_, level.height - tileY);
+            int64_t          tileW = std::min<int64_t>(tileSize_, level.width - tileX);
+            if (entry.offset > fileSize_ || entry.size > fileSize_ - entry.offset ||
+                (!entry.compressed && entry.size != static_cast<size_t>(tileH) * tileW * 3)) {
+                close();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*************************************************
+ * void close()
+ *
+ * 機能 : ファイルのメモリマップを解除し、展開したタイルを破棄
+ *
+ * return : void
+ *************************************************/
+void TiledImage::close()
+{
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t *>(data_), fileSize_);
+    }
+    data_     = nullptr;
+    fileSize_ = 0;
+    tileSize_ = 0;
+    levels_.clear();
+    index_.clear();
+    decoded_.clear();
+}
+
+/*************************************************
+ * Mat tile(int32_t level, int32_t tx, int32_t ty)
+ * int32_t level : レベル (0が等倍)
+ * int32_t tx : 横方向のタイルの番号
+ * int32_t ty : 縦方向のタイルの番号
+ *
+ * 機能 : タイルを取得 (初めて参照したときにマップから読み込む)
+ *        無圧縮のタイルはマップからコピーする (マップは読み出し専用のため、返す画像には書き込んでよい)
+ *        圧縮したタイルは展開してキャッシュに保持する
+ *
+ * return : Mat タイルの画像 (右端と下端のタイルは小さい)、レベルやタイルの番号が範囲外、データが不正な場合は空
+ *************************************************/
+Mat TiledImage::tile(int32_t level, int32_t tx, int32_t ty)
+{
+    Mat tileImg = loadTile(level, tx, ty);
+    if (tileImg.data >= data_ && tileImg.data < data_ + fileSize_) {
+        return tileImg.clone();
+    }
+    return tileImg;
+}
+
+// タイルを取得 (無圧縮のタイルはマップを直接参照するため、すぐにコピーして書き込まないこと)
+Mat TiledImage::loadTile(int32_t level, int32_t tx, int32_t ty)
+{
+    if (level < 0 || level >= levels() || tx < 0 || tx >= levels_[level].tilesX || ty < 0 ||
+        ty >= levels_[level].tilesY) {
+        return Mat{};
+    }
+
+    const Level     &lv    = levels_[level];
+    const TileEntry &entry = index_[lv.firstTile + static_cast<size_t>(ty) * lv.tilesX + tx];
+    int32_t          tileH = std::min(tileSize_, lv.height - ty * tileSize_);
+    int32_t          tileW = std::min(tileSize_, lv.width - tx * tileSize_);
+
+    if (!entry.compressed) {
+        tileLoads_++;
+        return Mat{tileH, tileW, CV_8UC3, const_cast<uint8_t *>(data_ + entry.offset)};
+    }
+
+    Mat        tileImg = Mat{tileH, tileW, CV_8UC3};
+    cache::Key key     = cache::KeyHasher().add(level).add(tx).add(ty).key();
+    if (decoded_.lookup(key, tileImg, tileH, tileW)) {
+        return tileImg;
+    }
+
+    tileLoads_++;
+    size_t tileBytes = static_cast<size_t>(tileH) * tileW * 3;
+    if (!lzDecompress(data_ + entry.offset, entry.size, tileImg.ptr<uint8_t>(0), tileBytes)) {
+        return Mat{};
+    }
+    deltaDecode(tileImg.ptr<uint8_t>(0), tileH, tileW * 3);
+    decoded_.store(key, tileImg, tileH, tileW);
+    return tileImg;
+}
+
+/*************************************************
+ * Mat readRegion(Rect rect, int32_t level)
+ * Rect rect : 読み込む矩形 (レベルの画像での座標、画像外の部分は除く)
+ * int32_t level : レベル (0が等倍)
+ *
+ * 機能 : 矩形に重なるタイルだけを読み込み、矩形の画像を作成
+ *
+ * return : Mat 矩形の画像 (矩形が画像外、レベルが範囲外、またはデータが不正な場合は空)
+ *************************************************/
+Mat TiledImage::readRegion(Rect rect, int32_t level)
+{
+    rect &= Rect(0, 0, width(level), height(level));
+    if (rect.area() <= 0) {
+        return Mat{};
+    }
+
+    Mat region = Mat{rect.height, rect.width, CV_8UC3};
+    for (int32_t ty = rect.y / tileSize_; ty <= (rect.br().y - 1) / tileSize_; ty++) {
+        for (int32_t tx = rect.x / tileSize_; tx <= (rect.br().x - 1) / tileSize_; tx++) {
+            Mat tileImg = loadTile(level, tx, ty);
+            if (tileImg.empty()) {
+                return Mat{};
+            }
+
+            // タイルと矩形の重なりをコピー
+            Rect overlap = Rect(tx * tileSize_, ty * tileSize_, tileImg.cols, tileImg.rows) & rect;
+            for (int32_t y = overlap.y; y < overlap.br().y; y++) {
+                const uint8_t *src = tileImg.ptr<uint8_t>(y - ty * tileSize_) + (overlap.x - tx * tileSize_) * 3;
+                std::copy(src, src + overlap.width * 3, region.ptr<uint8_t>(y - rect.y) + (overlap.x - rect.x) * 3);
+            }
+        }
+    }
+    return region;
+}
+
+/*************************************************
+ * bool process(Rect rect, int32_t level, Size radius, BorderType borderType, const roi::Op &op, Mat outImg)
+ * Rect rect : 出力する矩形 (レベルの画像での座標)
+ * int32_t level : レベル (0が等倍、縮小画像ではpreview::scaleRadiusなどで処理のパラメータを調整する)
+ * Size radius : 処理の参照範囲 (roi::filterRadius、roi::pixelwiseRadiusで求める)
+ * BorderType borderType : 処理で使う画像の端の処理
+ * const roi::Op &op : 処理 (pixelwise、filterの処理を呼ぶ)
+ * Mat outImg : 出力画像 (rectの大きさ)
+ *
+ * 機能 : 矩形を参照範囲だけ広げた窓のタイルだけを読み込んで処理し、矩形の部分を出力画像に書き込む
+ *        窓の縁が画像の端と一致する場合は処理の端の処理がそのまま使われる
+ *        (画像全体を参照する処理やWrapで端に接する場合は、レベルの画像全体を読み込む)
+ *        結果の丸めについてはroi::processRegionsと同じ (FFTによる畳み込みは窓の大きさで丸めが変わりうる)
+ *
+ * return : bool 処理した場合はtrue (矩形が画像外、レベルが範囲外、またはデータが不正な場合はfalse)
+ *************************************************/
+bool TiledImage::process(Rect rect, int32_t level, Size radius, BorderType borderType, const roi::Op &op, Mat outImg)
+{
+    rect &= Rect(0, 0, width(level), height(level));
+    if (rect.area() <= 0) {
+        return false;
+    }
+
+    Rect window = roi::windowOf(rect, height(level), width(level), radius, borderType);
+    Mat  inImg  = readRegion(window, level);
+    if (inImg.empty()) {
+        return false;
+    }
+
+    Mat result = Mat{window.height, window.width, CV_8UC3};
+    op(inImg, window.height, window.width, window, result);
+
+    Rect inner = rect - window.tl();
+    for (int32_t y = 0; y < inner.height; y++) {
+        const uint8_t *src = result.ptr<uint8_t>(inner.y + y) + inner.x * 3;
+        std::copy(src, src + inner.width * 3, outImg.ptr<uint8_t>(y));
+    }
+    return true;
+}
+
+}  // namespace tiled
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../border.h"
+#include "../cache/cache.h"
+#include "../roi/roi.h"
+#include <atomic>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+// タイル形式の画像ファイル
+// 画像ピラミッドの各レベルを固定サイズのタイルに分けて格納し、先頭の索引からタイルの位置を求める
+// ファイルはメモリマップで開き、領域や縮小画像の処理では必要なタイルだけを読み込む
+namespace tiled {
+
+constexpr uint32_t TILED_MAGIC       = 0x54535049;  // "IPST"
+constexpr uint32_t TILED_VERSION     = 1;
+constexpr int32_t  DEFAULT_TILE_SIZE = 256;
+constexpr int32_t  DEFAULT_LEVELS    = 4;  // 等倍、1/2、1/4、1/8 (previewのピラミッドと同じ)
+
+// タイルの圧縮
+enum class Compression : int32_t
+{
+    None = 0,
+    Lz   = 1,  // 左隣の画素との差分 + LZ4ブロック形式 (圧縮しても小さくならないタイルは無圧縮で格納)
+};
+
+bool write(const std::string &path, Mat img, int32_t height, int32_t width, int32_t tileSize = DEFAULT_TILE_SIZE,
+           Compression compression = Compression::Lz, int32_t levels = DEFAULT_LEVELS);
+bool convertBmp(const std::string &bmpPath, const std::string &tiledPath, int32_t tileSize = DEFAULT_TILE_SIZE,
+                Compression compression = Compression::Lz, int32_t levels = DEFAULT_LEVELS);
+
+// タイル形式の画像ファイルの読み込み
+class TiledImage
+{
+public:
+    explicit TiledImage(size_t cacheBytes = 64 << 20);
+    ~TiledImage();
+
+    bool open(const std::string &path);
+    void close();
+
+    // 存在しないレベルの高さと横幅は0
+    int32_t levels() const { return static_cast<int32_t>(levels_.size()); }
+    int32_t height(int32_t level = 0) const { return level >= 0 && level < levels() ? levels_[level].height : 0; }
+    int32_t width(int32_t level = 0) const { return level >= 0 && level < levels() ? levels_[level].width : 0; }
+    int32_t tileSize() const { return tileSize_; }
+    int64_t tileLoads() const { return tileLoads_.load(); }  // マップから読み込んだタイルの数 (キャッシュは除く)
+
+    Mat  tile(int32_t level, int32_t tx, int32_t ty);
+    Mat  readRegion(Rect rect, int32_t level = 0);
+    bool process(Rect rect, int32_t level, Size radius, BorderType borderType, const roi::Op &op, Mat outImg);
+
+private:
+    struct Level
+    {
+        int32_t height;
+        int32_t width;
+        int32_t tilesX;
+        int32_t tilesY;
+        size_t  firstTile;  // 索引での最初のタイルの位置
+    };
+
+    struct TileEntry
+    {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t compressed;  // 1の場合は圧縮
+    };
+
+    Mat loadTile(int32_t level, int32_t tx, int32_t ty);
+
+    const uint8_t         *data_     = nullptr;
+    size_t                 fileSize_ = 0;
+    int32_t                tileSize_ = 0;
+    std::vector<Level>     levels_;
+    std::vector<TileEntry> index_;
+    cache::ResultCache     decoded_;  // 展開したタイル
+    std::atomic<int64_t>   tileLoads_{0};
+};
+
+}  // namespace tiled
@@ -0,0 +1,394 @@
+#include "tune.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace tune {
+
+namespace {
+constexpr double  SLOW_RUN_MS        = 200.0;  // これより遅い設定は1回だけ計測する
+constexpr int32_t BENCH_FILTER_COEFF = 3;      // EqualizationFilter, BoxFilter, AdaptiveThresholdの計測に使う半径 (7x7)
+constexpr double  BENCH_THRESHOLD_K  = 0.2;    // AdaptiveThresholdの計測に使う標準偏差の影響度
+constexpr int32_t TILE_ROWS[]        = {16, 64, 256};
+
+// 画像の大きさの区分ごとの計測に使う画像の大きさ (高さ, 横幅)
+constexpr int32_t BENCH_SIZES[][2] = {
+    {480,  640 },  // Small
+    {1024, 1280},  // Medium
+    {2048, 2048},  // Large
+};
+
+void runFilter(filter::ImageProcessor &ips, filter::IpsType ipsType, Mat inImg, int32_t height, int32_t width,
+               Mat outImg)
+{
+    switch (ipsType) {
+    case filter::IpsType::EqualizationFilter:
+        ips.equalizationFilter(inImg, height, width, BENCH_FILTER_COEFF, outImg);
+        break;
+    case filter::IpsType::MedianFilter:
+        ips.medianFilter(inImg, height, width, outImg);
+        break;
+    case filter::IpsType::EdgeDetectionFilter:
+        ips.edgeDetectionFilter(inImg, height, width, outImg);
+        break;
+    case filter::IpsType::SobelFilter:
+        ips.sobelFilter(inImg, height, width, outImg);
+        break;
+    case filter::IpsType::PrewittFilter:
+        ips.prewittFilter(inImg, height, width, outImg);
+        break;
+    case filter::IpsType::RobertsFilter:
+        ips.robertsFilter(inImg, height, width, outImg);
+        break;
+    case filter::IpsType::BoxFilter:
+        ips.boxFilter(inImg, height, width, Mat{height, width, CV_8UC1, Scalar(BENCH_FILTER_COEFF)}, outImg);
+        break;
+    case filter::IpsType::AdaptiveThreshold:
+        ips.adaptiveThresholdFilter(inImg, height, width, BENCH_FILTER_COEFF, BENCH_THRESHOLD_K, outImg);
+        break;
+    default:
+        break;
+    }
+}
+
+// 処理ごとに計測する実装
+std::vector<filter::Variant> variantsOf(filter::IpsType ipsType)
+{
+    switch (ipsType) {
+    case filter::IpsType::EqualizationFilter:
+        return {filter::Variant::Scalar, filter::Variant::Integral};
+    case filter::IpsType::MedianFilter:
+    case filter::IpsType::EdgeDetectionFilter:
+    case filter::IpsType::SobelFilter:
+    case filter::IpsType::PrewittFilter:
+    case filter::IpsType::RobertsFilter:
+#ifdef __SSE2__
+        return {filter::Variant::Scalar, filter::Variant::Simd};
+#else
+        return {filter::Variant::Scalar};
+#endif
+    default:
+        return {filter::Variant::Scalar};
+    }
+}
+
+// 計測するスレッド数 (1, 2, 4, ... とCPUのスレッド数)
+std::vector<int32_t> threadCandidates()
+{
+    int32_t              maxThreads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int32_t> threads;
+    for (int32_t n = 1; n < maxThreads; n *= 2) {
+        threads.push_back(n);
+    }
+    threads.push_back(maxThreads);
+    return threads;
+}
+
+// 計測用の画像 (再現できる疑似乱数と緩やかな濃淡の和、中央値やエッジの処理量が実画像に近くなるようにする)
+Mat benchImage(int32_t height, int32_t width)
+{
+    Mat      img   = Mat{height, width, CV_8UC3};
+    uint32_t state = 0x12345678;
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t *row = img.ptr<uint8_t>(y);
+        for (int32_t i = 0; i < width * 3; i++) {
+            state  = state * 1664525u + 1013904223u;
+            row[i] = static_cast<uint8_t>((y + i / 3) / 8 + (state >> 27));
+        }
+    }
+    return img;
+}
+}  // namespace
+
+/*************************************************
+ * bool load(const std::string &path)
+ * const std::string &path : プロファイルファイル
+ *
+ * 機能 : プロファイルを読み込む (壊れたファイルでも例外を投げず、falseを返して計測し直させる)
+ *        スレッド数は1以上、この機種の論理コア数以下に収める (別の機種で計測したファイルの場合)
+ *
+ * return : bool 開けない、版が異なる、または書式や値が不正な場合はfalse
+ *************************************************/
+bool Profile::load(const std::string &path)
+{
+    std::ifstream ifs(path);
+    std::string   line;
+    int32_t       version    = 0;
+    int32_t       maxThreads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+
+    entries.clear();
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.compare(0, 8, "version ") == 0) {
+            if (std::from_chars(line.data() + 8, line.data() + line.size(), version).ec != std::errc()) {
+                return false;
+            }
+            continue;
+        }
+        if (line.compare(0, 5, "host ") == 0) {
+            host = line.substr(5);
+            continue;
+        }
+
+        std::istringstream iss(line);
+        Entry              entry;
+        int32_t            ipsType, sizeClass, variant;
+        if (!(iss >> ipsType >> sizeClass >> entry.config.threadNum >> entry.config.tileRows >> variant >> entry.ms) ||
+            ipsType < static_cast<int32_t>(filter::IpsType::EqualizationFilter) ||
+            ipsType > static_cast<int32_t>(filter::IpsType::Convolution) ||
+            sizeClass < static_cast<int32_t>(filter::SizeClass::Small) ||
+            sizeClass > static_cast<int32_t>(filter::SizeClass::Large) ||
+            variant < static_cast<int32_t>(filter::Variant::Scalar) ||
+            variant > static_cast<int32_t>(filter::Variant::Direct) || entry.config.tileRows < 0) {
+            return false;
+        }
+        entry.ipsType          = static_cast<filter::IpsType>(ipsType);
+        entry.sizeClass        = static_cast<filter::SizeClass>(sizeClass);
+        entry.config.variant   = static_cast<filter::Variant>(variant);
+        entry.config.threadNum = std::clamp(entry.config.threadNum, 1, maxThreads);
+        entries.push_back(entry);
+    }
+    return version == PROFILE_VERSION && !entries.empty();
+}
+
+/*************************************************
+ * bool save(const std::string &path) const
+ * const std::string &path : プロファイルファイル
+ *
+ * 機能 : プロファイルを書き出す (1行に1つの処理と画像の大きさの区分)
+ *
+ * return : bool 書き込めなかった場合はfalse
+ *************************************************/
+bool Profile::save(const std::string &path) const
+{
+    std::ofstream ofs(path, std::ios::trunc);
+    ofs << "# ips_c_sample tuning profile\n";
+    ofs << "# ipsType sizeClass threadNum tileRows variant ms\n";
+    ofs << "version " << PROFILE_VERSION << "\n";
+    ofs << "host " << host << "\n";
+    for (const Entry &entry : entries) {
+        ofs << static_cast<int32_t>(entry.ipsType) << " " << static_cast<int32_t>(entry.sizeClass) << " "
+            << entry.config.threadNum << " " << entry.config.tileRows << " "
+            << static_cast<int32_t>(entry.config.variant) << " " << entry.ms << "\n";
+    }
+    return static_cast<bool>(ofs);
+}
+
+/*************************************************
+ * void apply(filter::ImageProcessor &ips, int32_t maxThreads) const
+ * filter::ImageProcessor &ips : フィルタ処理
+ * int32_t maxThreads : 1つの処理が使うスレッド数の上限 (複数のワーカが並行して処理する場合にコア数を分け合う)
+ *
+ * 機能 : プロファイルの設定をフィルタ処理に指定
+ *
+ * return : void
+ *************************************************/
+void Profile::apply(filter::ImageProcessor &ips, int32_t maxThreads) const
+{
+    for (const Entry &entry : entries) {
+        filter::TuneConfig config = entry.config;
+        config.threadNum          = std::clamp(config.threadNum, 1, std::max(maxThreads, 1));
+        ips.setTuning(entry.ipsType, entry.sizeClass, config);
+    }
+}
+
+/*************************************************
+ * std::string hostSignature()
+ *
+ * 機能 : 機種を識別する文字列 (CPUの型番とスレッド数)
+ *
+ * return : std::string 機種を識別する文字列
+ *************************************************/
+std::string hostSignature()
+{
+    std::ifstream ifs("/proc/cpuinfo");
+    std::string   line, model = "unknown";
+    while (std::getline(ifs, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t pos = line.find(':');
+            model      = pos != std::string::npos ? line.substr(pos + 2) : line;
+            break;
+        }
+    }
+    return model + " / " + std::to_string(std::thread::hardware_concurrency()) + " threads";
+}
+
+/*************************************************
+ * Tuner(int32_t repeat)
+ * int32_t repeat : 設定ごとの計測回数 (最小値を使う)
+ *************************************************/
+Tuner::Tuner(int32_t repeat) : repeat_(std::max(repeat, 1))
+{
+}
+
+/*************************************************
+ * std::vector<filter::IpsType> defaultTypes()
+ *
+ * 機能 : 自動調整の対象の処理 (実行時の設定で速さが変わる処理)
+ *
+ * return : std::vector<filter::IpsType> 処理の一覧
+ *************************************************/
+std::vector<filter::IpsType> Tuner::defaultTypes()
+{
+    return {filter::IpsType::EqualizationFilter, filter::IpsType::MedianFilter,  filter::IpsType::EdgeDetectionFilter,
+            filter::IpsType::SobelFilter,        filter::IpsType::PrewittFilter, filter::IpsType::RobertsFilter,
+            filter::IpsType::BoxFilter,          filter::IpsType::AdaptiveThreshold};
+}
+
+/*************************************************
+ * Profile run(const std::vector<filter::IpsType> &ipsTypes)
+ * const std::vector<filter::IpsType> &ipsTypes : 対象の処理
+ *
+ * 機能 : 処理と画像の大きさの区分ごとに候補の設定を計測し、最速の設定を求める
+ *        実装ごとにスレッド数を決めてから帯の行数を決める (すべての組み合わせは計測しない)
+ *        既定の設定(1スレッド、Scalar)と結果が異なる設定は使わない
+ *
+ * return : Profile 最速の設定
+ *************************************************/
+Profile Tuner::run(const std::vector<filter::IpsType> &ipsTypes)
+{
+    Profile profile;
+    profile.host = hostSignature();
+
+    std::vector<int32_t> threads = threadCandidates();
+    for (int32_t sizeIdx = 0; sizeIdx < 3; sizeIdx++) {
+        int32_t height = BENCH_SIZES[sizeIdx][0];
+        int32_t width  = BENCH_SIZES[sizeIdx][1];
+        Mat     inImg  = benchImage(height, width);
+
+        for (filter::IpsType ipsType : ipsTypes) {
+            // 既定の設定の結果 (候補の設定の結果と比べる)
+            filter::ImageProcessor base;
+            Mat                    refImg = Mat{height, width, CV_8UC3};
+            runFilter(base, ipsType, inImg, height, width, refImg);
+
+            Entry best;
+            best.ipsType   = ipsType;
+            best.sizeClass = static_cast<filter::SizeClass>(sizeIdx);
+            best.ms        = measure(ipsType, best.config, inImg, height, width, refImg, 0.0);
+
+            for (filter::Variant variant : variantsOf(ipsType)) {
+                filter::TuneConfig bestOfVariant;
+                double             bestOfVariantMs = -1.0;
+
+                // スレッド数 (帯の行数は高さ / スレッド数)
+                for (int32_t threadNum : threads) {
+                    filter::TuneConfig config{threadNum, 0, variant};
+                    double             ms = measure(ipsType, config, inImg, height, width, refImg, best.ms);
+                    if (ms >= 0.0 && (bestOfVariantMs < 0.0 || ms < bestOfVariantMs)) {
+                        bestOfVariant   = config;
+                        bestOfVariantMs = ms;
+                    }
+                }
+
+                // 帯の行数 (複数スレッドの場合のみ意味がある)
+                if (bestOfVariant.threadNum > 1) {
+                    for (int32_t tileRows : TILE_ROWS) {
+                        filter::TuneConfig config{bestOfVariant.threadNum, tileRows, variant};
+                        double             ms = measure(ipsType, config, inImg, height, width, refImg, best.ms);
+                        if (ms >= 0.0 && ms < bestOfVariantMs) {
+                            bestOfVariant   = config;
+                            bestOfVariantMs = ms;
+                        }
+                    }
+                }
+
+                if (bestOfVariantMs >= 0.0 && bestOfVariantMs < best.ms) {
+                    best.config = bestOfVariant;
+                    best.ms     = bestOfVariantMs;
+                }
+            }
+            profile.entries.push_back(best);
+        }
+    }
+    return profile;
+}
+
+/*************************************************
+ * double measure(filter::IpsType ipsType, const filter::TuneConfig &config, Mat inImg, int32_t height,
+ *                int32_t width, Mat refImg, double bestMs)
+ * filter::IpsType ipsType : 処理
+ * const filter::TuneConfig &config : 設定
+ * Mat inImg : 計測用の画像
+ * int32_t height : 高さ
+ * int32_t width : 横幅
+ * Mat refImg : 既定の設定の結果
+ * double bestMs : これまでの最速の処理時間 (0の場合は比較しない)
+ *
+ * 機能 : 設定の処理時間を計測する (1回目で結果を確かめ、最速の2倍より遅ければ打ち切る)
+ *
+ * return : double 処理時間の最小値 (ms)、結果が既定の設定と異なる場合は-1
+ *************************************************/
+double Tuner::measure(filter::IpsType ipsType, const filter::TuneConfig &config, Mat inImg, int32_t height,
+                      int32_t width, Mat refImg, double bestMs)
+{
+    filter::ImageProcessor ips;
+    Mat                    outImg = Mat{height, width, CV_8UC3};
+    ips.setTuning(ipsType, filter::sizeClassOf(height, width), config);
+
+    double minMs = -1.0;
+    for (int32_t i = 0; i < repeat_; i++) {
+        auto start = std::chrono::steady_clock::now();
+        runFilter(ips, ipsType, inImg, height, width, outImg);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (i == 0) {
+            for (int32_t y = 0; y < height; y++) {
+                if (!std::equal(outImg.ptr<uint8_t>(y), outImg.ptr<uint8_t>(y) + width * 3, refImg.ptr<uint8_t>(y))) {
+                    return -1.0;
+                }
+            }
+        }
+
+        minMs = minMs < 0.0 ? ms : std::min(minMs, ms);
+        if (ms > SLOW_RUN_MS || (bestMs > 0.0 && ms > 2.0 * bestMs)) {
+            break;
+        }
+    }
+    return minMs;
+}
+
+/*************************************************
+ * bool loadOrTune(const std::string &path, Profile &profile)
+ * const std::string &path : プロファイルファイル
+ * Profile &profile : 読み込んだ、または計測したプロファイル
+ *
+ * 機能 : この機種のプロファイルがあれば読み込み、なければ(壊れている場合も)計測してプロファイルを保存する
+ *        (初回の計測には数十秒かかる、複数のワーカで使う場合は1回だけ呼んで各ワーカにapplyする)
+ *
+ * return : bool 保存済みのプロファイルを読み込んだ場合はtrue
+ *************************************************/
+bool loadOrTune(const std::string &path, Profile &profile)
+{
+    if (profile.load(path) && profile.host == hostSignature()) {
+        return true;
+    }
+
+    profile = Tuner().run();
+    profile.save(path);
+    return false;
+}
+
+/*************************************************
+ * bool loadOrTune(const std::string &path, filter::ImageProcessor &ips)
+ * const std::string &path : プロファイルファイル
+ * filter::ImageProcessor &ips : 設定を指定するフィルタ処理
+ *
+ * 機能 : プロファイルを読み込むか計測し、フィルタ処理に指定する
+ *
+ * return : bool 保存済みのプロファイルを読み込んだ場合はtrue
+ *************************************************/
+bool loadOrTune(const std::string &path, filter::ImageProcessor &ips)
+{
+    Profile profile;
+    bool    loaded = loadOrTune(path, profile);
+    profile.apply(ips);
+    return loaded;
+}
+
+}  // namespace tune
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../filter/filter.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 機種ごとの自動調整
+// 候補の設定(スレッド数、帯の行数、実装)を計測し、処理と画像の大きさの区分ごとに最速の設定をプロファイルに保存する
+namespace tune {
+
+constexpr int32_t PROFILE_VERSION = 1;
+
+// 処理と画像の大きさの区分ごとの最速の設定
+struct Entry
+{
+    filter::IpsType    ipsType   = filter::IpsType::None;
+    filter::SizeClass  sizeClass = filter::SizeClass::Small;
+    filter::TuneConfig config;
+    double             ms = 0.0;  // 計測した処理時間
+};
+
+// 機種ごとの設定 (プロファイルファイルに保存する)
+struct Profile
+{
+    std::string        host;  // CPUの型番とスレッド数 (別の機種で作ったプロファイルは使わない)
+    std::vector<Entry> entries;
+
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+    void apply(filter::ImageProcessor &ips, int32_t maxThreads = INT32_MAX) const;
+};
+
+std::string hostSignature();
+
+class Tuner
+{
+public:
+    explicit Tuner(int32_t repeat = 3);
+
+    Profile                             run(const std::vector<filter::IpsType> &ipsTypes = defaultTypes());
+    static std::vector<filter::IpsType> defaultTypes();
+
+private:
+    double measure(filter::IpsType ipsType, const filter::TuneConfig &config, Mat inImg, int32_t height,
+                   int32_t width, Mat refImg, double bestMs);
+
+    int32_t repeat_;
+};
+
+bool loadOrTune(const std::string &path, Profile &profile);
+bool loadOrTune(const std::string &path, filter::ImageProcessor &ips);
+
+}  // namespace tune